@@ -0,0 +1,59 @@
+#pragma once
+
+#include "stdint.h"
+#include <bit>
+
+// Bit tricks on bitboards, all constexpr. std::popcount and std::countr_zero compile to single instructions (popcnt, tzcnt) where
+// the CPU has them. Square indices follow ChessBoard, square 0 is a8 and is the lowest bit.
+class BitUtilities final
+{
+public:
+	BitUtilities() = delete;
+
+	class SetBitRange;
+
+	static constexpr int PopCount(uint64_t bitBoard) { return std::popcount(bitBoard); }
+	// The lowest and highest set square, the bitboard can't be empty
+	static constexpr int GetLsb(uint64_t bitBoard) { return std::countr_zero(bitBoard); }
+	static constexpr int GetMsb(uint64_t bitBoard) { return 63 - std::countl_zero(bitBoard); }
+	// Clears the lowest set square and returns it
+	static constexpr int PopLsb(uint64_t& bitBoard)
+	{
+		const int squareIndex{ GetLsb(bitBoard) };
+		bitBoard &= bitBoard - 1;
+		return squareIndex;
+	}
+
+	// for (int squareIndex : BitUtilities::GetSetBits(bitBoard)) visits the set squares from low to high
+	static constexpr SetBitRange GetSetBits(uint64_t bitBoard);
+
+	class SetBitRange final
+	{
+	public:
+		class Iterator final
+		{
+		public:
+			constexpr explicit Iterator(uint64_t bitBoard) : m_BitBoard{ bitBoard } {}
+
+			constexpr int operator*() const { return GetLsb(m_BitBoard); }
+			constexpr Iterator& operator++() { m_BitBoard &= m_BitBoard - 1; return *this; }
+			constexpr bool operator!=(const Iterator& other) const { return m_BitBoard != other.m_BitBoard; }
+
+		private:
+			uint64_t m_BitBoard;
+		};
+
+		constexpr explicit SetBitRange(uint64_t bitBoard) : m_BitBoard{ bitBoard } {}
+
+		constexpr Iterator begin() const { return Iterator{ m_BitBoard }; }
+		constexpr Iterator end() const { return Iterator{ 0 }; }
+
+	private:
+		uint64_t m_BitBoard;
+	};
+};
+
+constexpr BitUtilities::SetBitRange BitUtilities::GetSetBits(uint64_t bitBoard) { return SetBitRange{ bitBoard }; }
+
+static_assert(BitUtilities::PopCount(0x8100000000000081) == 4);
+static_assert(BitUtilities::GetLsb(0x8100000000000080) == 7 && BitUtilities::GetMsb(0x8100000000000080) == 63);
@@ -1 +1,193 @@
 #include "ChessAI.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const std::pair<const char*, bool SearchFeatures::*> g_SearchFeatures[]
+	{
+		{ "NullMovePruning", &SearchFeatures::nullMovePruning },
+		{ "LateMoveReductions", &SearchFeatures::lateMoveReductions },
+		{ "ReverseFutilityPruning", &SearchFeatures::reverseFutilityPruning },
+		{ "FutilityPruning", &SearchFeatures::futilityPruning },
+		{ "CheckExtension", &SearchFeatures::checkExtension },
+		{ "TreeReuse", &SearchFeatures::treeReuse },
+		{ "CapturesFirstPlayouts", &SearchFeatures::capturesFirstPlayouts }
+	};
+}
+
+bool SearchFeatures::Set(const std::string& name, bool isEnabled)
+{
+	for (const auto& [featureName, pFeature] : g_SearchFeatures)
+	{
+		if (name != featureName) continue;
+
+		this->*pFeature = isEnabled;
+		return true;
+	}
+	return false;
+}
+std::vector<std::string> SearchFeatures::GetNames()
+{
+	std::vector<std::string> names{};
+	for (const auto& searchFeature : g_SearchFeatures)
+	{
+		names.emplace_back(searchFeature.first);
+	}
+	return names;
+}
+
+void ChessAI::SetSearchLimits(int depth, float timeLimit, bool isInfinite)
+{
+	m_SearchDepth = depth;
+	m_TimeLimit = timeLimit;
+	m_IsSearchInfinite = isInfinite;
+	// Every depth takes a few times longer than the one before, so one that starts after half the time rarely finishes
+	m_SoftTimeLimit = timeLimit * 0.5f;
+	m_IsStopRequested = false;
+}
+void ChessAI::SetSearchClock(float remainingTime, float increment, int movesToGo)
+{
+	const float moveOverhead{ 0.05f };
+	const int suddenDeathMovesToGo{ 30 };
+
+	float budget{ remainingTime / (movesToGo > 0 ? movesToGo : suddenDeathMovesToGo) + increment * 0.75f };
+
+	// A move may run over its budget when it has to, but never gets close to flagging
+	m_TimeLimit = std::max(std::min(budget * 2.f, remainingTime * 0.5f) - moveOverhead, 0.01f);
+	m_SoftTimeLimit = std::min(budget * 0.5f, m_TimeLimit);
+}
+
+MoveList ChessAI::GetPrincipalVariation(Move bestMove, int maxLength)
+{
+	MoveList principalVariation{};
+
+	// The root itself is never stored, its best move only comes from the search
+	TranspositionEntry entry{ 0.f, bestMove };
+	do
+	{
+		// A stored move can come from a colliding key, so only follow it if it is legal here
+		if (!m_pChessBoard->IsLegalMove(entry.bestMove)) break;
+
+		principalVariation.push_back(entry.bestMove);
+		m_pChessBoard->MakeMove(entry.bestMove);
+	}
+	while (int(principalVariation.size()) < maxLength && m_TranspositionTable.Probe(m_pChessBoard->GetZobristKey(), entry));
+	m_pChessBoard->UnMakeLastMove(int(principalVariation.size()));
+
+	return principalVariation;
+}
+
+float ChessAI::GetFirstMoveCutoffRate()
+{
+	uint64_t cutoffCount{ SumThreadStatistics(&ThreadStatistics::cutoffCount) };
+	return cutoffCount ? float(SumThreadStatistics(&ThreadStatistics::firstMoveCutoffCount)) / cutoffCount : 0.f;
+}
+float ChessAI::GetTranspositionTableHitRate()
+{
+	uint64_t probeCount{ SumThreadStatistics(&ThreadStatistics::probeCount) };
+	return probeCount ? float(SumThreadStatistics(&ThreadStatistics::hitCount)) / probeCount : 0.f;
+}
+
+void ChessAI::StartSearch()
+{
+	m_StartTimePoint = std::chrono::steady_clock::now();
+	m_IsTimeUp = false;
+	ResetSearchStatistics();
+}
+bool ChessAI::ShouldStop()
+{
+	if (IsSearchStopped()) return true;
+	if (GetThreadStatistics().nodeCount.load(std::memory_order_relaxed) % s_ClockCheckInterval != 0) return false;
+
+	// Helpers only need the clock for the time limit, the timer of the front ends follows the main search thread
+	if (s_ThreadIndex != 0 && m_TimeLimit <= 0.f) return false;
+
+	const float searchTime{ GetSearchTime() };
+	if (s_ThreadIndex == 0) m_CurrentMoveTime.store(searchTime, std::memory_order_relaxed);
+
+	if (m_TimeLimit > 0.f && searchTime >= m_TimeLimit)
+	{
+		m_IsTimeUp = true;
+	}
+	return IsSearchStopped();
+}
+void ChessAI::RunLazySMP(const std::function<void(int threadIndex)>& search)
+{
+	m_AreHelperThreadsStopped = false;
+
+	std::vector<std::thread> helperThreads{};
+	helperThreads.reserve(m_ThreadCount - 1);
+	for (int threadIndex{ 1 }; threadIndex < m_ThreadCount; ++threadIndex)
+	{
+		helperThreads.emplace_back([&search, threadIndex]()
+			{
+				s_ThreadIndex = threadIndex;
+				search(threadIndex);
+			});
+	}
+
+	search(0);
+
+	m_AreHelperThreadsStopped = true;
+	for (std::thread& helperThread : helperThreads)
+	{
+		helperThread.join();
+	}
+	m_AreHelperThreadsStopped = false;
+	m_CurrentMoveTime.store(GetSearchTime(), std::memory_order_relaxed);
+}
+void ChessAI::ResetSearchStatistics()
+{
+	m_LastPrincipalVariation.clear();
+	m_CurrentMoveTime.store(0.f, std::memory_order_relaxed);
+
+	for (ThreadStatistics& threadStatistics : m_ThreadStatistics)
+	{
+		for (auto pCounter : { &ThreadStatistics::nodeCount, &ThreadStatistics::quiescenceNodeCount, &ThreadStatistics::playoutCount, &ThreadStatistics::playoutPlyCount,
+							   &ThreadStatistics::cutoffCount, &ThreadStatistics::firstMoveCutoffCount, &ThreadStatistics::probeCount, &ThreadStatistics::hitCount })
+		{
+			(threadStatistics.*pCounter).store(0, std::memory_order_relaxed);
+		}
+	}
+}
+uint64_t ChessAI::SumThreadStatistics(std::atomic<uint64_t> ThreadStatistics::* pCounter)
+{
+	uint64_t sum{};
+	for (const ThreadStatistics& threadStatistics : m_ThreadStatistics)
+	{
+		sum += (threadStatistics.*pCounter).load(std::memory_order_relaxed);
+	}
+	return sum;
+}
+bool ChessAI::ProbeTranspositionTable(uint64_t zobristKey, TranspositionEntry& entry)
+{
+	ThreadStatistics& threadStatistics{ GetThreadStatistics() };
+	Count(threadStatistics.probeCount);
+
+	if (!m_TranspositionTable.Probe(zobristKey, entry)) return false;
+
+	Count(threadStatistics.hitCount);
+	return true;
+}
+void ChessAI::ReportSearchInfo(int depth, float score, Move bestMove, const MoveList& principalVariation)
+{
+	// A principal variation that doesn't start with the best move can't be trusted, like one from a search that failed low
+	m_LastPrincipalVariation.clear();
+	if (!principalVariation.empty() && principalVariation.front() == bestMove) m_LastPrincipalVariation = principalVariation;
+	m_CurrentMoveTime.store(GetSearchTime(), std::memory_order_relaxed);
+
+	if (!m_SearchInfoCallback) return;
+
+	SearchInfo searchInfo{};
+	searchInfo.depth = depth;
+	searchInfo.score = score;
+	ConvertScore(score, searchInfo);
+	searchInfo.nodeCount = GetNodeCount();
+	searchInfo.seconds = GetSearchTime();
+	searchInfo.bestMove = bestMove;
+	searchInfo.principalVariation = m_LastPrincipalVariation;
+
+	m_SearchInfoCallback(searchInfo);
+}
@@ -1,33 +1,179 @@
 #pragma once
 
 #include "ChessBoard.h"
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// What a searcher reports every time it finishes a depth, for front ends that want to show progress
+struct SearchInfo
+{
+	int depth{};
+	float score{};
+	// The score in centipawns from the side to move's view. When mateInMoves isn't 0 it's a mate instead: in that many moves, negative when getting mated.
+	// Both stay 0 for searchers whose score isn't in pawns
+	int centipawns{};
+	int mateInMoves{};
+	uint64_t nodeCount{};
+	float seconds{};
+	Move bestMove{};
+	// Starts with the best move, empty for searchers that don't keep one
+	MoveList principalVariation{};
+};
+
+// Pruning and extensions of the searchers that have them, the tree reuse and capture-first playouts of the MCTS, all on by default.
+// They can be switched off at runtime, to measure what each of them is worth
+struct SearchFeatures
+{
+	bool nullMovePruning{ true };
+	bool lateMoveReductions{ true };
+	bool reverseFutilityPruning{ true };
+	bool futilityPruning{ true };
+	bool checkExtension{ true };
+	bool treeReuse{ true };
+	bool capturesFirstPlayouts{ true };
+
+	// The names are the ones of the UCI options, like "NullMovePruning". Returns false for an unknown name
+	bool Set(const std::string& name, bool isEnabled);
+	static std::vector<std::string> GetNames();
+};
 
 class ChessAI
 {
 public:
 	ChessAI(ChessBoard* chessBoard, bool controllingWhite) : m_pChessBoard{ chessBoard }, m_ControllingWhite{controllingWhite} {};
-	~ChessAI() = default;
+	virtual ~ChessAI() = default;
 
-	ChessAI(const ChessAI& other) = default;
-	ChessAI(ChessAI&& other) = default;
-	ChessAI& operator=(const ChessAI& other) = default;
-	ChessAI& operator=(ChessAI&& other) noexcept = default;
+	ChessAI(const ChessAI& other) = delete;
+	ChessAI(ChessAI&& other) = delete;
+	ChessAI& operator=(const ChessAI& other) = delete;
+	ChessAI& operator=(ChessAI&& other) noexcept = delete;
 
 
 	virtual Move GetAIMove() = 0;
 	bool IsControllingWhite() { return m_ControllingWhite; }
-	float GetCurrentMoveTimer() { return std::chrono::duration<float>(m_CurrentTimePoint - m_StartTimePoint).count(); }
+	// Only follows the clock while the main search thread runs, so it can be read from any thread
+	float GetCurrentMoveTimer() { return m_CurrentMoveTime.load(std::memory_order_relaxed); }
+
+	// Nodes visited during the last GetAIMove
+	uint64_t GetNodeCount() { return SumThreadStatistics(&ThreadStatistics::nodeCount); }
+	// The part of the nodes that was visited by the quiescence search
+	uint64_t GetQuiescenceNodeCount() { return SumThreadStatistics(&ThreadStatistics::quiescenceNodeCount); }
+	// Positions MCST played out during the last GetAIMove, and the moves it played in them
+	uint64_t GetPlayoutCount() { return SumThreadStatistics(&ThreadStatistics::playoutCount); }
+	uint64_t GetPlayoutPlyCount() { return SumThreadStatistics(&ThreadStatistics::playoutPlyCount); }
+	// How often the first move searched in a node already caused its cutoff during the last GetAIMove, a measure of the move ordering
+	float GetFirstMoveCutoffRate();
+	// How many of the transposition table probes of the last GetAIMove found their position
+	float GetTranspositionTableHitRate();
+	const TranspositionTable& GetTranspositionTable() { return m_TranspositionTable; }
+	void SetTranspositionTableSize(int sizeInMB) { m_TranspositionTable.Resize(sizeInMB); }
+
+	// A depth of 0 keeps the version's own depth, a time limit (in seconds) of 0 searches without one.
+	// An infinite search without a depth deepens (V3) or grows its tree (MCST) until Stop, the fixed depth versions ignore it.
+	// Also clears an earlier Stop, so call it before every search that can be stopped
+	void SetSearchLimits(int depth, float timeLimit, bool isInfinite = false);
+	// Turns a chess clock into the time limits of this move, call it after SetSearchLimits. A movesToGo of 0 means sudden death
+	void SetSearchClock(float remainingTime, float increment, int movesToGo = 0);
+	// Can be called from any thread, GetAIMove then returns the best move it has fully searched as soon as possible
+	void Stop() { m_IsStopRequested = true; }
+	// For front ends that set up a new board for every position, the transposition table stays
+	void SetChessBoard(ChessBoard* pChessBoard) { m_pChessBoard = pChessBoard; }
+	// The transposition table stores scores from the side to move's view, so it stays valid when switching sides
+	void SetControllingWhite(bool controllingWhite) { m_ControllingWhite = controllingWhite; }
+	void SetSearchInfoCallback(std::function<void(const SearchInfo&)> callback) { m_SearchInfoCallback = std::move(callback); }
+	// Only the versions that search with Lazy SMP and MCST, which shares its tree between the threads, use more than one thread
+	void SetThreadCount(int threadCount) { m_ThreadCount = std::clamp(threadCount, 1, s_MaxThreadCount); }
+	int GetThreadCount() { return m_ThreadCount; }
+	// The most moves MCST plays from a leaf before it evaluates, 0 evaluates the leaf itself. The other versions don't play out
+	void SetPlayoutDepth(int playoutDepth) { m_PlayoutDepth = std::max(playoutDepth, 0); }
+	void SetSearchFeatures(const SearchFeatures& searchFeatures) { m_SearchFeatures = searchFeatures; }
+
+	// Starts with the best move of the search and follows the best moves stored in the transposition table after it
+	MoveList GetPrincipalVariation(Move bestMove, int maxLength);
+	// The principal variation the last finished depth reported, empty for searchers that don't keep one
+	const MoveList& GetLastPrincipalVariation() { return m_LastPrincipalVariation; }
+
+	static constexpr int s_MaxThreadCount{ 256 };
 
 protected:
 
+	// The counters of one search thread. Only that thread writes them, so they don't need atomic increments,
+	// and every thread has a cache line of its own. Front ends read them while the search runs, so they still are atomics
+	struct alignas(64) ThreadStatistics
+	{
+		std::atomic<uint64_t> nodeCount{};
+		std::atomic<uint64_t> quiescenceNodeCount{};
+		std::atomic<uint64_t> playoutCount{};
+		std::atomic<uint64_t> playoutPlyCount{};
+		std::atomic<uint64_t> cutoffCount{};
+		std::atomic<uint64_t> firstMoveCutoffCount{};
+		std::atomic<uint64_t> probeCount{};
+		std::atomic<uint64_t> hitCount{};
+	};
+	static_assert(sizeof(ThreadStatistics) == 64);
+
 	ChessBoard* m_pChessBoard;
 	bool m_ControllingWhite;
-	std::chrono::steady_clock::time_point m_CurrentTimePoint{std::chrono::steady_clock::now()};
 	std::chrono::steady_clock::time_point m_StartTimePoint{ std::chrono::steady_clock::now() };
+	std::atomic<float> m_CurrentMoveTime{};
+
+	// Only the searchers that use it give it a size, shared by all of their search threads
+	TranspositionTable m_TranspositionTable{};
+	ThreadStatistics m_ThreadStatistics[s_MaxThreadCount]{};
+	// The index RunLazySMP gave the thread, 0 on every thread that doesn't search with it
+	inline static thread_local int s_ThreadIndex{};
+
+	int m_SearchDepth{};
+	// Searches get aborted at the hard limit, searchers that deepen iteratively don't start a new depth after the soft one
+	float m_TimeLimit{};
+	float m_SoftTimeLimit{};
+	bool m_IsSearchInfinite{};
+	// Stop stays until the next SetSearchLimits, running out of time only ends the search it happened in
+	std::atomic<bool> m_IsStopRequested{};
+	std::atomic<bool> m_IsTimeUp{};
+	int m_ThreadCount{ 1 };
+	// Off by default, in self-play MCST scores its leaves better as they are than by playing them out
+	int m_PlayoutDepth{};
+	SearchFeatures m_SearchFeatures{};
+	std::atomic<bool> m_AreHelperThreadsStopped{};
+	std::function<void(const SearchInfo&)> m_SearchInfoCallback{};
+	MoveList m_LastPrincipalVariation{};
+
+	// Reading the clock costs more than searching a node, so every thread only reads it once per this many of its nodes
+	static constexpr uint64_t s_ClockCheckInterval{ 256 };
+
+	// Starts the clock, the statistics and the time limit of a new search, at the start of every GetAIMove
+	void StartSearch();
+	float GetSearchTime() { return std::chrono::duration<float>(std::chrono::steady_clock::now() - m_StartTimePoint).count(); }
+	bool ShouldStop();
+	// Once it is true every search thread has to unwind, the values they return from then on are garbage
+	bool IsSearchStopped() { return m_IsStopRequested || m_IsTimeUp || m_AreHelperThreadsStopped; }
 
+	// Lazy SMP: runs search(threadIndex) on m_ThreadCount threads that only share the transposition table (MCST shares its tree instead).
+	// The main search (index 0) runs on the calling thread, the helpers get stopped as soon as it returns so only its result counts
+	void RunLazySMP(const std::function<void(int threadIndex)>& search);
+	// Only call it from the main search thread
+	void ReportSearchInfo(int depth, float score, Move bestMove, const MoveList& principalVariation = {});
+	// Resets the node, playout, cutoff and probe counts of every thread
+	void ResetSearchStatistics();
+	ThreadStatistics& GetThreadStatistics() { return m_ThreadStatistics[s_ThreadIndex]; }
+	uint64_t SumThreadStatistics(std::atomic<uint64_t> ThreadStatistics::* pCounter);
+	// Only for the counters of the calling thread, which is the only one that writes them
+	static void Count(std::atomic<uint64_t>& counter, uint64_t amount = 1) { counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); }
+	void CountNode() { Count(GetThreadStatistics().nodeCount); }
+	void CountQuiescenceNode() { ThreadStatistics& threadStatistics{ GetThreadStatistics() }; Count(threadStatistics.nodeCount); Count(threadStatistics.quiescenceNodeCount); }
+	void CountCutoff(bool isFirstMove) { ThreadStatistics& threadStatistics{ GetThreadStatistics() }; Count(threadStatistics.cutoffCount); if (isFirstMove) Count(threadStatistics.firstMoveCutoffCount); }
+	// Probes the transposition table and counts the probe for the hit rate
+	bool ProbeTranspositionTable(uint64_t zobristKey, TranspositionEntry& entry);
 
-	virtual float BoardValueEvaluation(GameState gameState) { return 0.f; };
+	virtual float BoardValueEvaluation(const GameState& gameState) { return 0.f; };
+	// Fills in the centipawns or the mate distance of a reported score
+	virtual void ConvertScore(float score, SearchInfo& searchInfo) {};
 
 };
 
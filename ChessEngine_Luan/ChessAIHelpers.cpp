@@ -0,0 +1,74 @@
+#include "ChessAIHelpers.h"
+
+NodePool::~NodePool()
+{
+	for (int chunkIndex{}; chunkIndex < s_MaxChunkCount; ++chunkIndex)
+	{
+		delete[] m_pChunks[chunkIndex].load();
+		delete[] m_pSpareChunks[chunkIndex];
+	}
+}
+
+void NodePool::KeepSubtree(int nodeIndex)
+{
+	auto getSpareNode = [this](int index) -> Node&
+		{
+			Node*& pSpareChunk{ m_pSpareChunks[index >> s_ChunkShift] };
+			if (!pSpareChunk) pSpareChunk = new Node[s_ChunkSize];
+			return pSpareChunk[index & (s_ChunkSize - 1)];
+		};
+
+	getSpareNode(0) = (*this)[nodeIndex];
+	getSpareNode(0).parentIndex = -1;
+	int spareSize{ 1 };
+
+	// Copied breadth first into the spare chunks, so the children of a node stay next to each other.
+	// The nodes copied so far are the queue of the walk
+	for (int spareIndex{}; spareIndex < spareSize; ++spareIndex)
+	{
+		Node& node{ getSpareNode(spareIndex) };
+		const int firstChildIndex{ node.firstChildIndex };
+		if (firstChildIndex <= Node::s_UnexpandedIndex || node.childCount == 0) continue;
+
+		for (int childOffset{}; childOffset < node.childCount; ++childOffset)
+		{
+			Node& child{ getSpareNode(spareSize + childOffset) };
+			child = (*this)[firstChildIndex + childOffset];
+			child.parentIndex = spareIndex;
+		}
+
+		node.firstChildIndex = spareSize;
+		spareSize += node.childCount;
+	}
+
+	for (int chunkIndex{}; chunkIndex < s_MaxChunkCount; ++chunkIndex)
+	{
+		m_pSpareChunks[chunkIndex] = m_pChunks[chunkIndex].exchange(m_pSpareChunks[chunkIndex]);
+	}
+	m_Size = spareSize;
+}
+
+int NodePool::Allocate(int count)
+{
+	// Checked up front too, so threads that keep running into a full pool don't keep growing m_Size
+	if (m_Size.load(std::memory_order_relaxed) + count > s_MaxSize) return -1;
+
+	const int firstIndex{ m_Size.fetch_add(count) };
+	if (firstIndex + count > s_MaxSize) return -1;
+
+	for (int index{ firstIndex }; index < firstIndex + count; ++index)
+	{
+		if (index == firstIndex || (index & (s_ChunkSize - 1)) == 0) AllocateChunk(m_pChunks[index >> s_ChunkShift]);
+		(*this)[index] = Node{};
+	}
+	return firstIndex;
+}
+void NodePool::AllocateChunk(std::atomic<Node*>& pChunk)
+{
+	if (pChunk.load(std::memory_order_acquire)) return;
+
+	// Another thread can get there first, then its chunk is the one that stays
+	Node* pNewChunk{ new Node[s_ChunkSize] };
+	Node* pExpectedChunk{ nullptr };
+	if (!pChunk.compare_exchange_strong(pExpectedChunk, pNewChunk)) delete[] pNewChunk;
+}
@@ -1,96 +1,328 @@
 #include "ChessAI_Versions.h"
-#include <execution>
+#include "BitUtilities.h"
+#include "MovePicker.h"
+#include "PlayoutBoard.h"
+#include "RandomUtilities.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
 #include <ranges>
 
 #define FLOAT_MAX FLT_MAX
 #define FLOAT_MIN -FLOAT_MAX
 
+namespace
+{
+	// Value of a position where the side to move has no legal moves, from the perspective of the side to move
+	float NoLegalMovesValue(ChessBoard* pChessBoard, int ply)
+	{
+		// Stalemate
+		if (!pChessBoard->IsKingInCheck()) return 0.f;
+
+		return -(ChessAI_AlphaBeta::s_MateValue - ply);
+	}
+
+	// The transposition table stores mates as the distance from the node, the search scores them by the distance from the root
+	float ToTranspositionValue(float value, int ply)
+	{
+		if (!ChessAI_AlphaBeta::IsMateValue(value)) return value;
+		return value > 0.f ? value + ply : value - ply;
+	}
+	float FromTranspositionValue(float value, int ply)
+	{
+		if (!ChessAI_AlphaBeta::IsMateValue(value)) return value;
+		return value > 0.f ? value - ply : value + ply;
+	}
+
+	// The alpha-beta searches are negamax, every value is from the perspective of the side to move.
+	// The evaluations give it from the perspective of the controlling side
+	float ToSideToMove(float value, ChessBoard* pChessBoard, bool controllingWhite)
+	{
+		return pChessBoard->GetWhiteToMove() == controllingWhite ? value : -value;
+	}
+
+	// Late move reductions grow with the logarithm of both the depth and the number of the move
+	int GetLateMoveReduction(int depth, int moveNumber)
+	{
+		static const auto s_Reductions{ []
+			{
+				std::array<std::array<int, 64>, 64> reductions{};
+				for (int depthIndex{ 1 }; depthIndex < 64; ++depthIndex)
+				{
+					for (int moveIndex{ 1 }; moveIndex < 64; ++moveIndex)
+					{
+						reductions[depthIndex][moveIndex] = int(0.75 + std::log(depthIndex) * std::log(moveIndex) / 2.25);
+					}
+				}
+				return reductions;
+			}() };
+
+		return s_Reductions[std::min(depth, 63)][std::min(moveNumber, 63)];
+	}
+
+	// A search with the window (alpha, NullWindowBeta(alpha)) only answers whether a move is better than alpha, which makes it cheap
+	float NullWindowBeta(float alpha)
+	{
+		return std::nextafter(alpha, FLOAT_MAX);
+	}
+}
 
 
 Move ChessAI_V0::GetAIMove()
 {
-	auto moves{ m_pChessBoard->GetPossibleMoves() };
-	auto it{ moves.begin()};
+	const MoveList& moves{ m_pChessBoard->GetPossibleMoves() };
 
-	auto randomIndex{ rand() % moves.size() };
-	std::advance(it, randomIndex);
-
-	return *it;
+	return moves[rand() % moves.size()];
 }
 
 #pragma region AlphaBeta
 
-#pragma region V1
-Move ChessAI_V1_AlphaBeta::GetAIMove()
+float ChessAI_AlphaBeta::EvaluateForSideToMove(ChessBoard& chessBoard)
 {
-	m_StartTimePoint = std::chrono::steady_clock::now();
-
-	int depth{ 3 };
+	return ToSideToMove(BoardValueEvaluation(chessBoard.GetCurrentGameState(m_EvaluatesPossibleMoves)), &chessBoard, m_ControllingWhite);
+}
+void ChessAI_AlphaBeta::ConvertScore(float score, SearchInfo& searchInfo)
+{
+	if (!IsMateValue(score))
+	{
+		searchInfo.centipawns = int(std::lround(score * 100.f / m_PawnValue));
+		return;
+	}
 
-	auto possibleMoves{ m_pChessBoard->GetPossibleMoves() };
-	if (possibleMoves.size() == 1) return possibleMoves.front();
-	Move currentBestMove{};
-	float currentBestValue{FLOAT_MIN};
+	// A mate ply plies away is (ply + 1) / 2 moves of the side to move
+	int matePly{ int(s_MateValue - std::abs(score)) };
+	searchInfo.mateInMoves = (score > 0.f ? 1 : -1) * (matePly + 1) / 2;
+}
+Move ChessAI_AlphaBeta::SearchRoot(int depth, float alpha, float beta, const MoveList& rootMoves, SearchThreadData& thread, float& bestValue)
+{
+	ChessBoard& chessBoard{ thread.chessBoard };
 
-	float alpha{FLOAT_MIN};
-	float beta{FLOAT_MAX};
+	Move bestMove{ rootMoves.front() };
+	bestValue = FLOAT_MIN;
+	thread.principalVariation.Clear(0);
 
-	for (int index{}; index < possibleMoves.size(); ++index)
+	int legalMoveCount{};
+	for (Move move : rootMoves)
 	{
+		if (!chessBoard.MakePseudoLegalMove(move)) continue;
+		++legalMoveCount;
 
-		auto it{ possibleMoves.begin() };
-		std::advance(it, index);
-		Move move{ *it };
+		float moveValue{};
+		if (legalMoveCount == 1) moveValue = -DepthSearch(depth - 1, 1, -beta, -alpha, thread);
+		else
+		{
+			moveValue = -DepthSearch(depth - 1, 1, -NullWindowBeta(alpha), -alpha, thread);
+			if (moveValue > alpha && moveValue < beta) moveValue = -DepthSearch(depth - 1, 1, -beta, -alpha, thread);
+		}
+		chessBoard.UnMakeLastMove();
+
+		// A stopped search returns garbage, only the moves searched before it count
+		if (IsSearchStopped()) break;
+		if (moveValue > bestValue)
+		{
+			bestMove = move;
+			bestValue = moveValue;
+			if (moveValue > alpha)
+			{
+				alpha = moveValue;
+				thread.principalVariation.Update(0, move);
+			}
+		}
+		// Only happens with an aspiration window, which then gets widened
+		if (alpha >= beta) break;
+	}
+	return bestMove;
+}
+float ChessAI_AlphaBeta::DepthSearch(int depth, int ply, float alpha, float beta, SearchThreadData& thread)
+{
+	ChessBoard& chessBoard{ thread.chessBoard };
+	thread.principalVariation.Clear(ply);
 
-		m_pChessBoard->MakeMove(move);
+	const bool isInCheck{ chessBoard.IsKingInCheck() };
+	depth += GetExtension(ply, isInCheck);
 
-		float moveValue{ DepthSearch(depth - 1, alpha, beta) };
-		if (moveValue > currentBestValue) { currentBestMove = move; currentBestValue = moveValue; }
+	// Captures get played out before a position gets evaluated
+	if (depth == 0) return Quiescence(alpha, beta, ply, chessBoard);
 
-		m_pChessBoard->UnMakeLastMove();
+	CountNode();
+	if (ShouldStop()) return 0.f;
+	if (chessBoard.GetGameProgress() != GameProgress::InProgress)
+	{
+		// Pseudo-legal moves don't show checkmate, only a position in check can be one
+		if (isInCheck && chessBoard.GetPossibleMoves().size() == 0) return NoLegalMovesValue(&chessBoard, ply);
+		return EvaluateForSideToMove(chessBoard);
 	}
 
-	return currentBestMove;
-}
-float ChessAI_V1_AlphaBeta::DepthSearch(int depth, float alpha, float beta)
-{
-	m_CurrentTimePoint = std::chrono::steady_clock::now();
+	// Only the nodes searched with an open window can be on the principal variation, the rest get scouted with a null window
+	const bool isPrincipalVariationNode{ beta > NullWindowBeta(alpha) };
 
-	bool isMinimizer{ !bool(depth & 1) };
+	const uint64_t zobristKey{ chessBoard.GetZobristKey() };
+	Move hashMove{};
 
-	if (depth == 0) return BoardValueEvaluation(m_pChessBoard->GetCurrentGameState());
+	TranspositionEntry entry{};
+	if (ProbeTranspositionTable(zobristKey, entry))
+	{
+		entry.score = FromTranspositionValue(entry.score, ply);
 
-	auto possibleMoves{ m_pChessBoard->GetPossibleMoves() };
-	float currentMoveValue{ isMinimizer ? FLOAT_MAX : FLOAT_MIN};
+		// Cutting off on the principal variation would cut the line it reports short
+		if (entry.depth >= depth && !isPrincipalVariationNode)
+		{
+			if (entry.boundType == BoundType::Exact) return entry.score;
+			if (entry.boundType == BoundType::LowerBound && entry.score >= beta) return entry.score;
+			if (entry.boundType == BoundType::UpperBound && entry.score <= alpha) return entry.score;
+		}
+		hashMove = entry.bestMove;
+	}
+	const float originalAlpha{ alpha };
 
-	for (const auto& move : possibleMoves)
+	// The pruning trusts the static evaluation, which means little in check, and stays off the principal variation
+	NodePruning nodePruning{};
+	if (!isPrincipalVariationNode && !isInCheck)
 	{
-		m_pChessBoard->MakeMove(move);
-		float moveValue{ DepthSearch(depth - 1, alpha, beta) };
-		m_pChessBoard->UnMakeLastMove();
+		nodePruning = PruneNode(depth, ply, alpha, beta, thread);
+		if (IsSearchStopped()) return 0.f;
+		if (nodePruning.isPruned) return nodePruning.value;
+	}
+
+	float bestValue{ FLOAT_MIN };
+	Move bestMove{};
+
+	// The best move of an earlier visit first, then the captures, the killer and counter moves and the quiet moves by their history.
+	// The quiet moves only get generated when nothing before them cuts off
+	// Legality only gets checked for the moves that actually get searched
+	MovePicker movePicker{ chessBoard, hashMove, &thread.moveOrdering, ply };
+
+	int legalMoveCount{};
+	// The quiet moves that didn't cut off, a cutoff after them lowers their history
+	MoveList searchedQuietMoves{};
+	for (Move move : movePicker)
+	{
+		if (!chessBoard.MakePseudoLegalMove(move)) continue;
+		++legalMoveCount;
+
+		const bool isQuietMove{ MovePicker::IsQuietMove(move) };
+		// The opponent is the side to move now
+		const bool givesCheck{ chessBoard.IsKingInCheck() };
 
-		if (!isMinimizer)
+		if (nodePruning.canPruneQuietMoves && legalMoveCount > 1 && isQuietMove && !givesCheck)
 		{
-			currentMoveValue = max(currentMoveValue, moveValue);
-			if (currentMoveValue > beta) 
-				break;
-			
-			alpha = max(alpha, currentMoveValue);
+			chessBoard.UnMakeLastMove();
+			continue;
 		}
+
+		// Principal variation search: the first move is expected to be the best, the others only have to be proven worse.
+		// A move that turns out better than alpha after all gets searched again with the full window
+		float moveValue{};
+		if (legalMoveCount == 1) moveValue = -DepthSearch(depth - 1, ply + 1, -beta, -alpha, thread);
 		else
 		{
-			currentMoveValue = min(currentMoveValue, moveValue);
-			if (currentMoveValue < alpha) 
-				break;
-			
-			beta = min(beta, currentMoveValue);
-		}		
+			// A reduced move that beats alpha anyway gets scouted again at the full depth
+			const int reduction{ isQuietMove && !isInCheck && !givesCheck ? GetReduction(depth, legalMoveCount, isPrincipalVariationNode) : 0 };
+
+			moveValue = -DepthSearch(depth - 1 - reduction, ply + 1, -NullWindowBeta(alpha), -alpha, thread);
+			if (reduction > 0 && moveValue > alpha) moveValue = -DepthSearch(depth - 1, ply + 1, -NullWindowBeta(alpha), -alpha, thread);
+			if (moveValue > alpha && moveValue < beta) moveValue = -DepthSearch(depth - 1, ply + 1, -beta, -alpha, thread);
+		}
+		chessBoard.UnMakeLastMove();
+		if (IsSearchStopped()) return 0.f;
 
+		if (moveValue > bestValue)
+		{
+			bestValue = moveValue;
+			bestMove = move;
+			if (moveValue > alpha)
+			{
+				alpha = moveValue;
+				thread.principalVariation.Update(ply, move);
+			}
+		}
+
+		if (alpha >= beta)
+		{
+			thread.moveOrdering.UpdateCutoff(chessBoard.GetWhiteToMove(), ply, depth, chessBoard.GetLastMove(), move, searchedQuietMoves);
+			CountCutoff(legalMoveCount == 1);
+			break;
+		}
+		if (isQuietMove) searchedQuietMoves.push_back(move);
 	}
+	if (legalMoveCount == 0) return NoLegalMovesValue(&chessBoard, ply);
+
+	BoundType boundType{ BoundType::Exact };
+	if (bestValue <= originalAlpha) boundType = BoundType::UpperBound;
+	else if (bestValue >= beta) boundType = BoundType::LowerBound;
+	m_TranspositionTable.Store(zobristKey, depth, boundType, ToTranspositionValue(bestValue, ply), bestMove);
 
-	return currentMoveValue;
+	return bestValue;
 }
-float ChessAI_V1_AlphaBeta::BoardValueEvaluation(GameState gameState)
+float ChessAI_AlphaBeta::Quiescence(float alpha, float beta, int ply, ChessBoard& chessBoard)
+{
+	CountQuiescenceNode();
+	if (ShouldStop()) return 0.f;
+	if (chessBoard.GetGameProgress() != GameProgress::InProgress) return EvaluateForSideToMove(chessBoard);
+
+	// In check the side to move can't stand pat, so every evasion gets searched
+	const bool isInCheck{ chessBoard.IsKingInCheck() };
+
+	// Standing pat: the side to move doesn't have to capture, so the evaluation is what it gets at least
+	float standPat{};
+	float bestValue{ FLOAT_MIN };
+	if (!isInCheck)
+	{
+		standPat = EvaluateForSideToMove(chessBoard);
+		if (standPat >= beta) return standPat;
+
+		alpha = std::max(alpha, standPat);
+		bestValue = standPat;
+	}
+
+	MovePicker movePicker{ chessBoard, isInCheck ? MoveGenerationType::All : MoveGenerationType::Captures };
+
+	bool hasLegalMove{ false };
+	for (Move move : movePicker)
+	{
+		// Delta pruning: a capture that doesn't reach alpha even with a margin on top of the material it wins isn't worth searching
+		if (!isInCheck && standPat + MoveOrdering::GetMaterialGain(chessBoard, move) * m_PawnValue + m_DeltaMargin < alpha) continue;
+
+		if (!chessBoard.MakePseudoLegalMove(move)) continue;
+		hasLegalMove = true;
+
+		float moveValue{ -Quiescence(-beta, -alpha, ply + 1, chessBoard) };
+		chessBoard.UnMakeLastMove();
+		if (IsSearchStopped()) return 0.f;
+
+		bestValue = std::max(bestValue, moveValue);
+		alpha = std::max(alpha, moveValue);
+		if (alpha >= beta) break;
+	}
+	if (isInCheck && !hasLegalMove) return NoLegalMovesValue(&chessBoard, ply);
+
+	return bestValue;
+}
+
+#pragma region V1
+Move ChessAI_V1_AlphaBeta::GetAIMove()
+{
+	StartSearch();
+	m_TranspositionTable.NewSearch();
+	m_MoveOrdering.Clear();
+
+	int depth{ m_SearchDepth ? m_SearchDepth : 3 };
+
+	auto possibleMoves{ m_pChessBoard->GetPossibleMoves() };
+	if (possibleMoves.empty()) return Move{};
+	if (possibleMoves.size() == 1) return possibleMoves.front();
+
+	SearchThreadData thread{ *m_pChessBoard, m_MoveOrdering, m_PrincipalVariation };
+	float bestValue{ FLOAT_MIN };
+	Move bestMove{ SearchRoot(depth, FLOAT_MIN, FLOAT_MAX, possibleMoves, thread, bestValue) };
+	if (IsSearchStopped()) return bestMove;
+
+	ReportSearchInfo(depth, bestValue, bestMove, m_PrincipalVariation.GetPrincipalVariation());
+	return bestMove;
+}
+float ChessAI_V1_AlphaBeta::BoardValueEvaluation(const GameState& gameState)
 {
 	switch (gameState.gameProgress)
 	{
@@ -104,11 +336,11 @@ float ChessAI_V1_AlphaBeta::BoardValueEvaluation(GameState gameState)
 	}
 	case GameProgress::WhiteWon:
 	{
-		return m_ControllingWhite ? FLOAT_MAX - 100.f : FLOAT_MIN + 100.f;
+		return m_ControllingWhite ? s_MateValue : -s_MateValue;
 	}
 	case GameProgress::BlackWon:
 	{
-		return m_ControllingWhite ? FLOAT_MIN + 100.f : FLOAT_MAX - 100.f;
+		return m_ControllingWhite ? -s_MateValue : s_MateValue;
 	}
 	default:
 		break;
@@ -125,23 +357,17 @@ float ChessAI_V1_AlphaBeta::BoardValueEvaluation(GameState gameState)
 	constexpr float rookValue{ 5 };
 	constexpr float queenValue{ 9 };
 
-	for (int index{}; index < 64; ++index)
-	{
-		uint64_t mask{ static_cast<unsigned long long>(1) << index };
+	const BitBoards& bitBoards{ gameState.bitBoards };
 
-		if (mask & gameState.bitBoards.whitePawns) whiteValue += pawnValue;
-		else if (mask & gameState.bitBoards.whiteKnights) whiteValue += knightValue;
-		else if (mask & gameState.bitBoards.whiteBishops) whiteValue += bishopValue;
-		else if (mask & gameState.bitBoards.whiteRooks) whiteValue += rookValue;
-		else if (mask & gameState.bitBoards.whiteQueens) whiteValue += queenValue;
+	whiteValue += pawnValue * BitUtilities::PopCount(bitBoards.whitePawns) + knightValue * BitUtilities::PopCount(bitBoards.whiteKnights) +
+				  bishopValue * BitUtilities::PopCount(bitBoards.whiteBishops) + rookValue * BitUtilities::PopCount(bitBoards.whiteRooks) +
+				  queenValue * BitUtilities::PopCount(bitBoards.whiteQueens);
 
-		else if (mask & gameState.bitBoards.blackPawns) blackValue += pawnValue;
-		else if (mask & gameState.bitBoards.blackKnights) blackValue += knightValue;
-		else if (mask & gameState.bitBoards.blackBishops) blackValue += bishopValue;
-		else if (mask & gameState.bitBoards.blackRooks) blackValue += rookValue;
-		else if (mask & gameState.bitBoards.blackQueens) blackValue += queenValue;
-	}
+	blackValue += pawnValue * BitUtilities::PopCount(bitBoards.blackPawns) + knightValue * BitUtilities::PopCount(bitBoards.blackKnights) +
+				  bishopValue * BitUtilities::PopCount(bitBoards.blackBishops) + rookValue * BitUtilities::PopCount(bitBoards.blackRooks) +
+				  queenValue * BitUtilities::PopCount(bitBoards.blackQueens);
 
+	// Always from this AI's side, like the scores of a finished game, whoever is to move in the position
 	return m_ControllingWhite ? whiteValue - blackValue : blackValue - whiteValue;
 }
 #pragma endregion
@@ -149,74 +375,47 @@ float ChessAI_V1_AlphaBeta::BoardValueEvaluation(GameState gameState)
 #pragma region V2
 Move ChessAI_V2_AlphaBeta::GetAIMove()
 {
-	m_StartTimePoint = std::chrono::steady_clock::now();
+	StartSearch();
+	m_TranspositionTable.NewSearch();
 
-	int depth{ 5 };
+	int depth{ m_SearchDepth ? m_SearchDepth : 5 };
 
 	auto possibleMoves{ m_pChessBoard->GetPossibleMoves() };
+	// Checkmate or stalemate, there is nothing to search and the threads would have no root move to start at
+	if (possibleMoves.empty()) return Move{};
 	if (possibleMoves.size() == 1) return possibleMoves.front();
 	
-	Move currentBestMove{ possibleMoves.front() };
-	float currentBestValue{ FLOAT_MIN };
-
-	float alpha{ FLOAT_MIN };
-	float beta{ FLOAT_MAX };
-
-	std::for_each(std::execution::par, possibleMoves.begin(), possibleMoves.end(), [&](Move move)
-	{
-		ChessBoard copyBoard{ *m_pChessBoard };
-		copyBoard.MakeMove(move);
+	// The threads copy this one, reporting the principal variation walks over m_pChessBoard while they start up
+	const ChessBoard rootBoard{ *m_pChessBoard };
 
-		float moveValue{ DepthSearch(depth - 1, alpha, beta, &copyBoard) };
-		if (moveValue > currentBestValue) { currentBestMove = move; currentBestValue = moveValue; }		
-	});
-	return currentBestMove;
-}
-float ChessAI_V2_AlphaBeta::DepthSearch(int depth, float alpha, float beta, ChessBoard* pChessBoard)
-{
-	m_CurrentTimePoint = std::chrono::steady_clock::now();
-
-	bool isMinimizer{ !bool(depth & 1) };
-
-
-	if (depth == 0) return BoardValueEvaluation(pChessBoard->GetCurrentGameState());
-
-	auto possibleMoves{ pChessBoard->GetPossibleMoves() };
-	float currentMoveValue{ isMinimizer ? FLOAT_MAX : FLOAT_MIN };
-
-	for (const auto& move : possibleMoves)
-	{
-		pChessBoard->MakeMove(move);
-		float moveValue{ DepthSearch(depth - 1, alpha, beta, pChessBoard) };
-		pChessBoard->UnMakeLastMove();
-
-		if (!isMinimizer)
+	Move bestMove{ possibleMoves.front() };
+	RunLazySMP([&](int threadIndex)
 		{
-			currentMoveValue = max(currentMoveValue, moveValue);
-			if (currentMoveValue > beta)
-				break;
-
-			alpha = max(alpha, currentMoveValue);
-		}
-		else
-		{
-			currentMoveValue = min(currentMoveValue, moveValue);
-			if (currentMoveValue < alpha)
-				break;
-
-			beta = min(beta, currentMoveValue);
-		}
-
-	}
-
-	return currentMoveValue;
+			ChessBoard chessBoard{ rootBoard };
+			// Too big for the stack of a thread, and every thread learns its own killers, history and principal variation
+			auto pMoveOrdering{ std::make_unique<MoveOrdering>() };
+			auto pPrincipalVariation{ std::make_unique<PrincipalVariationTable>() };
+
+			// Helpers start at other moves, so they fill the transposition table with what the main thread needs later
+			MoveList rootMoves{ possibleMoves };
+			std::rotate(rootMoves.begin(), rootMoves.begin() + threadIndex % rootMoves.size(), rootMoves.end());
+
+			SearchThreadData thread{ chessBoard, *pMoveOrdering, *pPrincipalVariation };
+			float bestValue{ FLOAT_MIN };
+			Move searchBestMove{ SearchRoot(depth, FLOAT_MIN, FLOAT_MAX, rootMoves, thread, bestValue) };
+			if (threadIndex != 0 || IsSearchStopped()) return;
+
+			bestMove = searchBestMove;
+			ReportSearchInfo(depth, bestValue, bestMove, pPrincipalVariation->GetPrincipalVariation());
+		});
+	return bestMove;
 }
-float ChessAI_V2_AlphaBeta::BoardValueEvaluation(GameState gameState)
+float ChessAI_V2_AlphaBeta::BoardValueEvaluation(const GameState& gameState)
 {
 	switch (gameState.gameProgress){
 		case GameProgress::Draw: return 0;
-		case GameProgress::WhiteWon: return m_ControllingWhite ? FLOAT_MAX - 100.f : FLOAT_MIN + 100.f;
-		case GameProgress::BlackWon: return m_ControllingWhite ? FLOAT_MIN + 100.f : FLOAT_MAX - 100.f;
+		case GameProgress::WhiteWon: return m_ControllingWhite ? s_MateValue : -s_MateValue;
+		case GameProgress::BlackWon: return m_ControllingWhite ? -s_MateValue : s_MateValue;
 		default: break; }
 
 
@@ -228,162 +427,170 @@ float ChessAI_V2_AlphaBeta::BoardValueEvaluation(GameState gameState)
 
 	return m_ControllingWhite ? boardValue : -boardValue;
 }
-float ChessAI_V2_AlphaBeta::MaterialBalance(GameState gameState)
+int ChessAI_V2_AlphaBeta::MaterialBalance(const GameState& gameState)
 {
-	int K{ AmountOfPieces(gameState.bitBoards.whiteKing) };
-	int Q{ AmountOfPieces(gameState.bitBoards.whiteQueens) };
-	int R{ AmountOfPieces(gameState.bitBoards.whiteRooks) };
-	int B{ AmountOfPieces(gameState.bitBoards.whiteBishops) };
-	int N{ AmountOfPieces(gameState.bitBoards.whiteKnights) };
-	int P{ AmountOfPieces(gameState.bitBoards.whitePawns) };
-	
-	int k{ AmountOfPieces(gameState.bitBoards.blackKing) };
-	int q{ AmountOfPieces(gameState.bitBoards.blackQueens) };
-	int r{ AmountOfPieces(gameState.bitBoards.blackRooks) };
-	int b{ AmountOfPieces(gameState.bitBoards.blackBishops) };
-	int n{ AmountOfPieces(gameState.bitBoards.blackKnights) };
-	int p{ AmountOfPieces(gameState.bitBoards.blackPawns) };
-	
-	int totalPieceAmount{ K + Q + R + B + N + P + k + q + r + b + n + p};
-	float gameStagePercent{totalPieceAmount / 32.f};
-
-	float value{};
-	for (int index{}; index < 64; ++index)
-	{
-		uint64_t mask{ static_cast<unsigned long long>(1) << index };
-
-		if		(mask & gameState.bitBoards.whitePawns)   value += m_PieceTables.pawnStartBlack[ 63 - index]	* gameStagePercent + m_PieceTables.pawnEndBlack[63 - index]		* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteKnights) value += m_PieceTables.knightStartBlack[63 - index]	* gameStagePercent + m_PieceTables.knightEndBlack[63 - index]	* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteBishops) value += m_PieceTables.bishopStartBlack[63 - index]	* gameStagePercent + m_PieceTables.bishopEndBlack[63 - index]	* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteRooks)	  value += m_PieceTables.rookStartBlack[63 - index]		* gameStagePercent + m_PieceTables.rookEndBlack[63 - index]		* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteQueens)  value += m_PieceTables.queenStartBlack[63 - index]	* gameStagePercent + m_PieceTables.queenEndBlack[63 - index]	* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteKing)	  value += m_PieceTables.kingStartBlack[63 - index]		* gameStagePercent + m_PieceTables.kingEndBlack[63 - index]		* (1 - gameStagePercent);
-
-
-		else if (mask & gameState.bitBoards.blackPawns)   value -= m_PieceTables.pawnStartBlack[index]		* gameStagePercent + m_PieceTables.pawnEndBlack[index]		* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackKnights) value -= m_PieceTables.knightStartBlack[index]	* gameStagePercent + m_PieceTables.knightEndBlack[index]	* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackBishops) value -= m_PieceTables.bishopStartBlack[index]	* gameStagePercent + m_PieceTables.bishopEndBlack[index]	* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackRooks)   value -= m_PieceTables.rookStartBlack[index]		* gameStagePercent + m_PieceTables.rookEndBlack[index]		* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackQueens)  value -= m_PieceTables.queenStartBlack[index]		* gameStagePercent + m_PieceTables.queenEndBlack[index]		* (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackKing)    value -= m_PieceTables.kingStartBlack[index]		* gameStagePercent + m_PieceTables.kingEndBlack[index]		* (1 - gameStagePercent);
-	}
-
-	return value;
+	return PieceSquareTables::GetTaperedScore(gameState.pieceSquareScore);
 }
-float ChessAI_V2_AlphaBeta::MoveBalance(GameState gameState)
+float ChessAI_V2_AlphaBeta::MoveBalance(const GameState& gameState)
 {
 	float amount{ float(gameState.possibleMoves.size()) - m_MoveAmountOffset };
 	return m_MoveAmountValue * (gameState.whiteToMove ? amount : -amount );
 }
-int ChessAI_V2_AlphaBeta::AmountOfPieces(uint64_t bitBoard)
-{
-	int amount{};
-	for (int index{}; index < 64; ++index)
-	{
-		if (bitBoard & (static_cast<unsigned long long>(1) << index)) ++amount;
-	}
-	return amount;
-}
 #pragma endregion
 
 #pragma region V3
 Move ChessAI_V3_AlphaBeta::GetAIMove()
 {
-	m_StartTimePoint = std::chrono::steady_clock::now();
+	StartSearch();
+	m_TranspositionTable.NewSearch();
 
 	auto possibleMoves{ m_pChessBoard->GetPossibleMoves() };
 
-	int W{ AmountOfPieces(m_pChessBoard->GetCurrentGameState().bitBoards.whitePieces) };
-	int B{ AmountOfPieces(m_pChessBoard->GetCurrentGameState().bitBoards.blackPieces) };
-	int totalPieceAmount{ W + B };
+	int totalPieceAmount{ m_pChessBoard->GetPieceSquareScore().pieceCount };
 
-	int depth{ 5 };
+	int maxDepth{ 5 };
 	if (totalPieceAmount <= 5)
 	{
-		depth = 13;
+		maxDepth = 13;
 	}
 	else if (totalPieceAmount <= 6)
 	{
-		depth = 11;
+		maxDepth = 11;
 	}
 	else if (totalPieceAmount <= 7)
 	{
-		depth = 9;
+		maxDepth = 9;
 	}
 	else if (totalPieceAmount <= 8)
 	{
-		depth = 7;
+		maxDepth = 7;
 	}
+	if (m_SearchDepth) maxDepth = m_SearchDepth;
+	// With a time limit the clock decides how deep the search gets, an infinite search deepens until it gets stopped
+	else if (m_TimeLimit > 0.f || m_IsSearchInfinite) maxDepth = s_MaxSearchDepth;
 
+	// Checkmate or stalemate, there is nothing to search and the threads would have no root move to start at
+	if (possibleMoves.empty()) return Move{};
 	if (possibleMoves.size() == 1) return possibleMoves.front();
 
-	Move currentBestMove{ possibleMoves.front() };
-	float currentBestValue{ FLOAT_MIN };
-
-	float alpha{ FLOAT_MIN };
-	float beta{ FLOAT_MAX };
+	// The threads copy this one, reporting the principal variation walks over m_pChessBoard while they start up
+	const ChessBoard rootBoard{ *m_pChessBoard };
 
-	std::for_each(std::execution::par, possibleMoves.begin(), possibleMoves.end(), [&](Move move)
+	Move bestMove{ possibleMoves.front() };
+	RunLazySMP([&](int threadIndex)
 		{
-			ChessBoard copyBoard{ *m_pChessBoard };
-			copyBoard.MakeMove(move);
-
-			float moveValue{ DepthSearch(depth - 1, alpha, beta, &copyBoard) };
-			if (moveValue > currentBestValue)
-			{ 
-				currentBestMove = move;
-				currentBestValue = moveValue; 
-			}
-		});
-	return currentBestMove;
-}
-float ChessAI_V3_AlphaBeta::DepthSearch(int depth, float alpha, float beta, ChessBoard* pChessBoard)
-{
-	m_CurrentTimePoint = std::chrono::steady_clock::now();
+			ChessBoard chessBoard{ rootBoard };
+			// Too big for the stack of a thread, and every thread learns its own killers, history and principal variation
+			auto pMoveOrdering{ std::make_unique<MoveOrdering>() };
+			auto pPrincipalVariation{ std::make_unique<PrincipalVariationTable>() };
 
-	bool isMinimizer{ !bool(depth & 1) };
+			// Helpers start at other moves and every other one a depth ahead,
+			// so they fill the transposition table with what the main thread needs later
+			MoveList rootMoves{ possibleMoves };
+			std::rotate(rootMoves.begin(), rootMoves.begin() + threadIndex % rootMoves.size(), rootMoves.end());
 
+			SearchThreadData thread{ chessBoard, *pMoveOrdering, *pPrincipalVariation };
+			float previousBestValue{};
 
-	if (depth == 0) return BoardValueEvaluation(pChessBoard->GetCurrentGameState());
+			// Every depth fills the transposition table with best moves that make the next depth cheaper
+			for (int depth{ 1 + (threadIndex & 1) }; depth <= maxDepth; ++depth)
+			{
+				if (threadIndex == 0 && depth > 1 && m_SoftTimeLimit > 0.f && GetSearchTime() >= m_SoftTimeLimit) break;
+
+				// Aspiration window: the score rarely moves far from the one of the depth before, and a narrow window cuts off more.
+				// A score outside of it only is a bound, so the side it fell out of gets widened until it fits
+				float window{ s_AspirationWindow };
+				float alpha{ FLOAT_MIN };
+				float beta{ FLOAT_MAX };
+				// Mate scores jump by whole plies, a window around them doesn't fit the next depth
+				if (depth >= s_AspirationMinDepth && !IsMateValue(previousBestValue))
+				{
+					alpha = previousBestValue - window;
+					beta = previousBestValue + window;
+				}
 
-	auto possibleMoves{ pChessBoard->GetPossibleMoves() };
-	float currentMoveValue{ isMinimizer ? FLOAT_MAX : FLOAT_MIN };
+				float bestValue{ FLOAT_MIN };
+				Move depthBestMove{};
+				while (true)
+				{
+					depthBestMove = SearchRoot(depth, alpha, beta, rootMoves, thread, bestValue);
+					if (IsSearchStopped()) break;
 
-	for (const auto& move : possibleMoves)
-	{
-		pChessBoard->MakeMove(move);
-		float moveValue{ DepthSearch(depth - 1, alpha, beta, pChessBoard) };
-		pChessBoard->UnMakeLastMove();
+					window *= 2.f;
+					if (bestValue <= alpha && alpha > FLOAT_MIN) alpha = window > s_MaxAspirationWindow ? FLOAT_MIN : bestValue - window;
+					else if (bestValue >= beta && beta < FLOAT_MAX) beta = window > s_MaxAspirationWindow ? FLOAT_MAX : bestValue + window;
+					else break;
+				}
 
-		if (!isMinimizer)
-		{
-			currentMoveValue = max(currentMoveValue, moveValue);
-			if (currentMoveValue > beta)
-				break;
+				// A stopped depth has only seen part of the moves, so only a finished one is trusted
+				if (IsSearchStopped()) break;
+				previousBestValue = bestValue;
 
-			alpha = max(alpha, currentMoveValue);
-		}
-		else
-		{
-			currentMoveValue = min(currentMoveValue, moveValue);
-			if (currentMoveValue < alpha)
-				break;
+				// The next depth searches this depth's best move first
+				Move* pBestMove{ std::find(rootMoves.begin(), rootMoves.end(), depthBestMove) };
+				std::rotate(rootMoves.begin(), pBestMove, pBestMove + 1);
 
-			beta = min(beta, currentMoveValue);
-		}
+				if (threadIndex != 0) continue;
 
-	}
+				bestMove = depthBestMove;
+				ReportSearchInfo(depth, bestValue, bestMove, pPrincipalVariation->GetPrincipalVariation());
 
-	return currentMoveValue;
+				// A forced win doesn't get any better by searching deeper
+				if (IsMateValue(bestValue) && bestValue > 0.f) break;
+			}
+		});
+	return bestMove;
+}
+int ChessAI_V3_AlphaBeta::GetExtension(int ply, bool isInCheck)
+{
+	// Check extension: a check gets searched a ply deeper, so the horizon doesn't cut a forcing line short.
+	// Past half of the maximum ply it stops, so the ply can't run out
+	return isInCheck && m_SearchFeatures.checkExtension && ply < MoveOrdering::s_MaxPly / 2 ? 1 : 0;
 }
+ChessAI_AlphaBeta::NodePruning ChessAI_V3_AlphaBeta::PruneNode(int depth, int ply, float alpha, float beta, SearchThreadData& thread)
+{
+	ChessBoard& chessBoard{ thread.chessBoard };
+	const float staticEvaluation{ EvaluateForSideToMove(chessBoard) };
+
+	// Reverse futility pruning: close to the horizon, a position this far above beta won't drop below it anymore
+	if (m_SearchFeatures.reverseFutilityPruning && depth <= s_ReverseFutilityMaxDepth && staticEvaluation - s_ReverseFutilityMargin * depth >= beta)
+	{
+		return NodePruning{ true, staticEvaluation };
+	}
+
+	// Null move pruning: if the score stays above beta even after passing, a real move would keep it there too.
+	// With only pawns left passing can be better than any move (zugzwang), and two passes in a row prove nothing
+	if (m_SearchFeatures.nullMovePruning && depth >= s_NullMoveMinDepth && staticEvaluation >= beta &&
+		!chessBoard.IsLastMoveNullMove() && chessBoard.HasNonPawnMaterial())
+	{
+		const int reduction{ s_NullMoveReduction + depth / 4 };
+
+		chessBoard.MakeNullMove();
+		float nullMoveValue{ -DepthSearch(std::max(depth - 1 - reduction, 0), ply + 1, -beta, NullWindowBeta(-beta), thread) };
+		chessBoard.UnMakeLastMove();
 
+		// A mate found after passing isn't a real one
+		if (nullMoveValue >= beta) return NodePruning{ true, beta };
+	}
+
+	// Futility pruning: close to the horizon, a quiet move can't lift a position this far below alpha up to it
+	NodePruning nodePruning{};
+	nodePruning.canPruneQuietMoves = m_SearchFeatures.futilityPruning && depth <= s_FutilityMaxDepth && staticEvaluation + s_FutilityMargin * depth <= alpha;
+	return nodePruning;
+}
+int ChessAI_V3_AlphaBeta::GetReduction(int depth, int moveNumber, bool isPrincipalVariationNode)
+{
+	// Late move reductions: the ordering puts the best moves first, so the late quiet ones get scouted less deep
+	if (!m_SearchFeatures.lateMoveReductions || depth < s_LateMoveReductionMinDepth || moveNumber <= s_LateMoveReductionMinMoves) return 0;
 
-float ChessAI_V3_AlphaBeta::BoardValueEvaluation(GameState gameState)
+	return std::clamp(GetLateMoveReduction(depth, moveNumber) - int(isPrincipalVariationNode), 0, depth - 2);
+}
+float ChessAI_V3_AlphaBeta::BoardValueEvaluation(const GameState& gameState)
 {
 	switch (gameState.gameProgress) {
 	case GameProgress::Draw: return 0;
-	case GameProgress::WhiteWon: return m_ControllingWhite ? FLOAT_MAX - 100.f : FLOAT_MIN + 100.f;
-	case GameProgress::BlackWon: return m_ControllingWhite ? FLOAT_MIN + 100.f : FLOAT_MAX - 100.f;
+	case GameProgress::WhiteWon: return m_ControllingWhite ? s_MateValue : -s_MateValue;
+	case GameProgress::BlackWon: return m_ControllingWhite ? -s_MateValue : s_MateValue;
 	default: break;
 	}
 
@@ -398,38 +605,11 @@ float ChessAI_V3_AlphaBeta::BoardValueEvaluation(GameState gameState)
 	return m_ControllingWhite ? boardValue : -boardValue;
 }
 
-float ChessAI_V3_AlphaBeta::MaterialBalance(GameState gameState)
+int ChessAI_V3_AlphaBeta::MaterialBalance(const GameState& gameState)
 {
-	int W{ AmountOfPieces(gameState.bitBoards.whitePieces) };
-	int B{ AmountOfPieces(gameState.bitBoards.blackPieces) };
-	
-	int totalPieceAmount{ W + B };
-	float gameStagePercent{ totalPieceAmount / 32.f };
-
-	float value{};
-	for (int index{}; index < 64; ++index)
-	{
-		uint64_t mask{ static_cast<unsigned long long>(1) << index };
-
-		if (mask & gameState.bitBoards.whitePawns)   value += m_PieceTables.pawnStartBlack[63 - index] * gameStagePercent + m_PieceTables.pawnEndBlack[63 - index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteKnights) value += m_PieceTables.knightStartBlack[63 - index] * gameStagePercent + m_PieceTables.knightEndBlack[63 - index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteBishops) value += m_PieceTables.bishopStartBlack[63 - index] * gameStagePercent + m_PieceTables.bishopEndBlack[63 - index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteRooks)	  value += m_PieceTables.rookStartBlack[63 - index] * gameStagePercent + m_PieceTables.rookEndBlack[63 - index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteQueens)  value += m_PieceTables.queenStartBlack[63 - index] * gameStagePercent + m_PieceTables.queenEndBlack[63 - index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.whiteKing)	  value += m_PieceTables.kingStartBlack[63 - index] * gameStagePercent + m_PieceTables.kingEndBlack[63 - index] * (1 - gameStagePercent);
-
-
-		else if (mask & gameState.bitBoards.blackPawns)   value -= m_PieceTables.pawnStartBlack[index] * gameStagePercent + m_PieceTables.pawnEndBlack[index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackKnights) value -= m_PieceTables.knightStartBlack[index] * gameStagePercent + m_PieceTables.knightEndBlack[index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackBishops) value -= m_PieceTables.bishopStartBlack[index] * gameStagePercent + m_PieceTables.bishopEndBlack[index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackRooks)   value -= m_PieceTables.rookStartBlack[index] * gameStagePercent + m_PieceTables.rookEndBlack[index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackQueens)  value -= m_PieceTables.queenStartBlack[index] * gameStagePercent + m_PieceTables.queenEndBlack[index] * (1 - gameStagePercent);
-		else if (mask & gameState.bitBoards.blackKing)    value -= m_PieceTables.kingStartBlack[index] * gameStagePercent + m_PieceTables.kingEndBlack[index] * (1 - gameStagePercent);
-	}
-
-	return value;
+	return PieceSquareTables::GetTaperedScore(gameState.pieceSquareScore);
 }
-float ChessAI_V3_AlphaBeta::MaterialConsiderations(GameState gameState)
+float ChessAI_V3_AlphaBeta::MaterialConsiderations(const GameState& gameState)
 {
 	float value{};
 
@@ -463,7 +643,7 @@ float ChessAI_V3_AlphaBeta::MaterialConsiderations(GameState gameState)
 }
 
 
-float ChessAI_V3_AlphaBeta::PawnStructure(GameState gameState)
+float ChessAI_V3_AlphaBeta::PawnStructure(const GameState& gameState)
 {
 	float value =	m_DoubledPawnsMult * DoubledPawns(gameState) +
 					m_IsolatedPawnsMult * IsolatedPawns(gameState) +
@@ -472,7 +652,7 @@ float ChessAI_V3_AlphaBeta::PawnStructure(GameState gameState)
 	return value;
 }
 
-float ChessAI_V3_AlphaBeta::DoubledPawns(GameState gameState)
+float ChessAI_V3_AlphaBeta::DoubledPawns(const GameState& gameState)
 {
 	int whiteDoubledPawns{};
 	int blackDoubledPawns{};
@@ -488,7 +668,7 @@ float ChessAI_V3_AlphaBeta::DoubledPawns(GameState gameState)
 
 	return float(whiteDoubledPawns - blackDoubledPawns);
 }
-float ChessAI_V3_AlphaBeta::IsolatedPawns(GameState gameState)
+float ChessAI_V3_AlphaBeta::IsolatedPawns(const GameState& gameState)
 {
 	int whiteIsolatedPawns{};
 	int blackIsolatedPawns{};
@@ -526,7 +706,7 @@ float ChessAI_V3_AlphaBeta::IsolatedPawns(GameState gameState)
 
 	return float(blackIsolatedPawns - whiteIsolatedPawns);
 }
-float ChessAI_V3_AlphaBeta::PassedPawns(GameState gameState)
+float ChessAI_V3_AlphaBeta::PassedPawns(const GameState& gameState)
 {
 	int whitePassedPawns{};
 	int blackPassedPawns{};
@@ -552,14 +732,11 @@ float ChessAI_V3_AlphaBeta::PassedPawns(GameState gameState)
 	return float(whitePassedPawns - blackPassedPawns);
 }
 
-float ChessAI_V3_AlphaBeta::Development(GameState gameState)
+float ChessAI_V3_AlphaBeta::Development(const GameState& gameState)
 {
 	float value{};
 
-	int W{ AmountOfPieces(gameState.bitBoards.whitePieces) };
-	int B{ AmountOfPieces(gameState.bitBoards.blackPieces) };
-	int totalPieceAmount{ W + B };
-	float gameStagePercent{ totalPieceAmount / 32.f };
+	float gameStagePercent{ gameState.pieceSquareScore.pieceCount / 32.f };
 
 
 	uint64_t whitePieces = gameState.bitBoards.whitePieces;
@@ -574,22 +751,13 @@ float ChessAI_V3_AlphaBeta::Development(GameState gameState)
 
 int ChessAI_V3_AlphaBeta::AmountOfPieces(uint64_t bitBoard)
 {
-	int amount{};
-	for (int index{}; index < 64; ++index)
-	{
-		if (bitBoard & (static_cast<unsigned long long>(1) << index)) ++amount;
-	}
-	return amount;
+	return BitUtilities::PopCount(bitBoard);
 }
 
 uint64_t ChessAI_V3_AlphaBeta::ColumnMask(int column)
 {
-	uint64_t bitBoard{0};
-	for (int index{ column }; index < 64; index += 8)
-	{
-		bitBoard |= static_cast<unsigned long long>(1) << index;
-	}
-	return bitBoard;
+	// Square 0 is a8, so the a-file is every 8th bit from the lowest up
+	return 0x0101010101010101ull << column;
 }
 #pragma endregion
 
@@ -600,55 +768,100 @@ uint64_t ChessAI_V3_AlphaBeta::ColumnMask(int column)
 
 Move ChessAI_V1_MCST::GetAIMove()
 {
-	m_StartTimePoint = std::chrono::steady_clock::now();
+	StartSearch();
 
-	auto pRoot{ std::make_unique<Node>() };
-	// Initializing the children of pRoot to start the algorithm
+	// The tree of the previous move is kept when the game went on from it, otherwise it is dropped as a whole.
+	// Either way the root is the first node
+	if (!m_SearchFeatures.treeReuse || !ReuseTree())
 	{
-		pRoot->gameState = m_pChessBoard->GetCurrentGameState();
-		for (const auto& move : m_pChessBoard->GetPossibleMoves())
-		{
-			m_pChessBoard->MakeMove(move);
-			pRoot->children.push_back(new Node{ move, pRoot.get(), m_pChessBoard->GetCurrentGameState() });
-			m_pChessBoard->UnMakeLastMove();
-		}
+		m_NodePool.Reset();
+		m_NodePool.Allocate(1);
 	}
+	const int rootIndex{ 0 };
+	m_TreeZobristKey = m_pChessBoard->GetZobristKey();
 
-	// Do the MCTS
-	for (int i = 0; i < m_Iterations; ++i) 
-	{
-		Node* selectedNode = SelectNode(pRoot.get());
-		
-		// If the selectedNode has been visited already	(the .visits is always 0 or 1 because of the while loop in SelectNode(...) )
-		if (selectedNode->visits == 1)
+	if (m_NodePool[rootIndex].childCount == 0) ExpandNode(rootIndex, *m_pChessBoard);
+	if (m_NodePool[rootIndex].childCount == 0) return Move{};
+
+	// Do the MCTS. Every thread walks the shared tree on its own copy of the board, without a time limit they share the iterations.
+	// An infinite search grows the tree until it gets stopped
+	const ChessBoard rootBoard{ *m_pChessBoard };
+	const bool hasTimeLimit{ m_TimeLimit > 0.f || m_IsSearchInfinite };
+	std::atomic<int> iterationCount{};
+
+	RunLazySMP([&](int threadIndex)
 		{
-			ExpandNode(selectedNode);
-			selectedNode = selectedNode->children.at(rand() % selectedNode->children.size());
-		}
+			ChessBoard chessBoard{ rootBoard };
+			// Differs per position and per thread, so no two playouts repeat each other
+			uint64_t randomState{ m_TreeZobristKey ^ (0x9E3779B97F4A7C15ull * (threadIndex + 1)) };
 
-		float nodeValue = Rollout(selectedNode);
-		Backpropagate(selectedNode, nodeValue);
-	}
+			while ((hasTimeLimit || iterationCount++ < m_Iterations) && !ShouldStop())
+			{
+				int selectedNodeIndex = SelectNode(rootIndex, chessBoard);
+
+				// A leaf gets its children the second time it is reached, one of them is the one that gets rolled out
+				if (m_NodePool[selectedNodeIndex].visits >= 1 && ExpandNode(selectedNodeIndex, chessBoard))
+				{
+					const Node& selectedNode{ m_NodePool[selectedNodeIndex] };
+					selectedNodeIndex = selectedNode.firstChildIndex + RandomUtilities::GetRandomIndex(selectedNode.childCount, randomState);
+					++m_NodePool[selectedNodeIndex].virtualLosses;
+					chessBoard.MakeMove(m_NodePool[selectedNodeIndex].move);
+				}
+
+				float nodeValue = Rollout(chessBoard, randomState);
+				Backpropagate(selectedNodeIndex, nodeValue, chessBoard);
+				CountNode();
+			}
+		});
 
 	// After the iterations, choose the best move based on statistics
-	Node* bestChild = nullptr;
+	const Node& root{ m_NodePool[rootIndex] };
+	int bestChildIndex = -1;
 	float bestScore = FLOAT_MIN;
 
-	for (Node* child : pRoot->children)
+	for (int childIndex{ root.firstChildIndex }; childIndex < root.firstChildIndex + root.childCount; ++childIndex)
 	{
-		float childScore = child->totalScore / child->visits;
+		const Node& child{ m_NodePool[childIndex] };
+
+		// Only possible when the search got stopped early
+		if (child.visits == 0) continue;
+
+		float childScore = child.totalScore / child.visits;
 
 		if (childScore > bestScore) 
 		{
 			bestScore = childScore;
-			bestChild = child;
+			bestChildIndex = childIndex;
 		}
 	}
 
-	if(bestChild) return bestChild->move;
-	return Move{};
+	if (bestChildIndex != -1) return m_NodePool[bestChildIndex].move;
+	return m_NodePool[root.firstChildIndex].move;
 }
-float ChessAI_V1_MCST::BoardValueEvaluation(GameState gameState)
+bool ChessAI_V1_MCST::ReuseTree()
+{
+	// The last two moves, the one this AI played and the reply, have to start from the root of the tree
+	if (m_NodePool.GetSize() == 0 || m_pChessBoard->GetPreviousZobristKey(1) != m_TreeZobristKey) return false;
+
+	int nodeIndex{ 0 };
+	for (int pliesAgo{ 1 }; pliesAgo >= 0; --pliesAgo)
+	{
+		const Move move{ m_pChessBoard->GetPreviousMove(pliesAgo) };
+		const Node& node{ m_NodePool[nodeIndex] };
+
+		int childIndex{ node.firstChildIndex };
+		while (childIndex < node.firstChildIndex + node.childCount && !(m_NodePool[childIndex].move == move)) ++childIndex;
+
+		// Never expanded that far
+		if (childIndex == node.firstChildIndex + node.childCount) return false;
+		nodeIndex = childIndex;
+	}
+
+	// Its siblings and everything above it go, the visits already spent on it stay
+	m_NodePool.KeepSubtree(nodeIndex);
+	return true;
+}
+float ChessAI_V1_MCST::BoardValueEvaluation(const GameState& gameState)
 {
 	switch (gameState.gameProgress)
 	{
@@ -683,44 +896,52 @@ float ChessAI_V1_MCST::BoardValueEvaluation(GameState gameState)
 	constexpr float rookValue{ 5 };
 	constexpr float queenValue{ 9 };
 
-	for (int index{}; index < 64; ++index)
-	{
-		uint64_t mask{ static_cast<unsigned long long>(1) << index };
+	const BitBoards& bitBoards{ gameState.bitBoards };
 
-		if (mask & gameState.bitBoards.whitePawns) whiteValue += pawnValue;
-		else if (mask & gameState.bitBoards.whiteKnights) whiteValue += knightValue;
-		else if (mask & gameState.bitBoards.whiteBishops) whiteValue += bishopValue;
-		else if (mask & gameState.bitBoards.whiteRooks) whiteValue += rookValue;
-		else if (mask & gameState.bitBoards.whiteQueens) whiteValue += queenValue;
+	whiteValue += pawnValue * BitUtilities::PopCount(bitBoards.whitePawns) + knightValue * BitUtilities::PopCount(bitBoards.whiteKnights) +
+				  bishopValue * BitUtilities::PopCount(bitBoards.whiteBishops) + rookValue * BitUtilities::PopCount(bitBoards.whiteRooks) +
+				  queenValue * BitUtilities::PopCount(bitBoards.whiteQueens);
 
-		else if (mask & gameState.bitBoards.blackPawns) blackValue += pawnValue;
-		else if (mask & gameState.bitBoards.blackKnights) blackValue += knightValue;
-		else if (mask & gameState.bitBoards.blackBishops) blackValue += bishopValue;
-		else if (mask & gameState.bitBoards.blackRooks) blackValue += rookValue;
-		else if (mask & gameState.bitBoards.blackQueens) blackValue += queenValue;
-	}
+	blackValue += pawnValue * BitUtilities::PopCount(bitBoards.blackPawns) + knightValue * BitUtilities::PopCount(bitBoards.blackKnights) +
+				  bishopValue * BitUtilities::PopCount(bitBoards.blackBishops) + rookValue * BitUtilities::PopCount(bitBoards.blackRooks) +
+				  queenValue * BitUtilities::PopCount(bitBoards.blackQueens);
 
-	return m_ControllingWhite == gameState.whiteToMove ? whiteValue - blackValue : blackValue - whiteValue;
+	// Always from this AI's side, like the scores of a finished game, whoever is to move in the position
+	return m_ControllingWhite ? whiteValue - blackValue : blackValue - whiteValue;
 }
 
-Node* ChessAI_V1_MCST::SelectNode(Node* node) 
+int ChessAI_V1_MCST::SelectNode(int nodeIndex, ChessBoard& chessBoard) 
 {
-	do
+	while (true)
 	{
-		bool isEnemyNode{ node->gameState.whiteToMove != m_ControllingWhite };
+		const Node& node{ m_NodePool[nodeIndex] };
+		// A leaf, a node without moves (or whose children didn't fit in the pool) or one another thread is expanding right now
+		const int firstChildIndex{ node.firstChildIndex.load(std::memory_order_acquire) };
+		if (firstChildIndex <= Node::s_UnexpandedIndex || node.childCount == 0) break;
+
+		bool isEnemyNode{ chessBoard.GetWhiteToMove() != m_ControllingWhite };
 
 		float bestUCB1{isEnemyNode? FLOAT_MAX : FLOAT_MIN};
-		Node* selectedChild{ node->children.back()};
+		int selectedChildIndex{ firstChildIndex + node.childCount - 1 };
 
-		for (Node* child : node->children)
+		// The threads still on their way down count as visits that lost, so the others spread out over the tree.
+		// This thread's own virtual loss on the node doesn't count, so a single thread selects the same nodes as without them
+		const float virtualLossScore{ isEnemyNode ? s_VirtualLoss : -s_VirtualLoss };
+		const int ownVirtualLoss{ node.parentIndex != -1 ? 1 : 0 };
+		const int nodeVisits{ std::max(node.visits + node.virtualLosses - ownVirtualLoss, 1) };
+
+		for (int childIndex{ firstChildIndex }; childIndex < firstChildIndex + node.childCount; ++childIndex)
 		{
-			if (child->visits == 0) { selectedChild = child; break; }
+			const Node& child{ m_NodePool[childIndex] };
+			const int virtualLosses{ child.virtualLosses };
+			const int childVisits{ child.visits + virtualLosses };
+			if (childVisits == 0) { selectedChildIndex = childIndex; break; }
 
 
 			constexpr float C = 0.42f; // Constant C for UCB1 formula
 
-			const float exploitationTerm{ child->totalScore / child->visits };
-			const float explorationTerm{ sqrt(logf(float(node->visits)) / child->visits) };
+			const float exploitationTerm{ (child.totalScore + virtualLossScore * virtualLosses) / childVisits };
+			const float explorationTerm{ std::sqrt(std::log(float(nodeVisits)) / childVisits) };
 			const float ucb1 = exploitationTerm + C * explorationTerm;
 			
 			if (!isEnemyNode)
@@ -728,7 +949,7 @@ Node* ChessAI_V1_MCST::SelectNode(Node* node)
 				if (ucb1 > bestUCB1)
 				{
 					bestUCB1 = ucb1;
-					selectedChild = child;
+					selectedChildIndex = childIndex;
 				}
 			}
 			else
@@ -736,60 +957,84 @@ Node* ChessAI_V1_MCST::SelectNode(Node* node)
 				if (ucb1 < bestUCB1)
 				{
 					bestUCB1 = ucb1;
-					selectedChild = child;
+					selectedChildIndex = childIndex;
 				}
 			}
 		}
 
-		node = selectedChild;
-
-	} 
-	while (node->visits > 1);
-	
+		nodeIndex = selectedChildIndex;
+		++m_NodePool[nodeIndex].virtualLosses;
+		chessBoard.MakeMove(m_NodePool[nodeIndex].move);
+	}
 
-	return node;
+	return nodeIndex;
 }
-void ChessAI_V1_MCST::ExpandNode(Node* node)
+bool ChessAI_V1_MCST::ExpandNode(int nodeIndex, ChessBoard& chessBoard)
 {
-	for (const auto& move : node->gameState.possibleMoves) 
+	// Only one thread gets to expand a node, it stays a leaf for the others until the children are in place
+	Node& node{ m_NodePool[nodeIndex] };
+	int expectedIndex{ Node::s_UnexpandedIndex };
+	if (!node.firstChildIndex.compare_exchange_strong(expectedIndex, Node::s_ExpandingIndex)) return false;
+
+	const MoveList& possibleMoves{ chessBoard.GetPossibleMoves() };
+	const int firstChildIndex{ chessBoard.GetGameProgress() == GameProgress::InProgress ? m_NodePool.Allocate(possibleMoves.size()) : -1 };
+	if (firstChildIndex == -1)
 	{
-		m_pChessBoard->MakeMove(node->move);
-
-		Node* newNode = new Node{move, node, m_pChessBoard->GetCurrentGameState() };
-		node->children.push_back(newNode);
+		node.firstChildIndex = Node::s_UnexpandedIndex;
+		return false;
+	}
 
-		m_pChessBoard->UnMakeLastMove();
+	for (int moveIndex{}; moveIndex < possibleMoves.size(); ++moveIndex)
+	{
+		Node& child{ m_NodePool[firstChildIndex + moveIndex] };
+		child.move = possibleMoves[moveIndex];
+		child.parentIndex = nodeIndex;
 	}
 
+	node.childCount = uint16_t(possibleMoves.size());
+	node.firstChildIndex.store(firstChildIndex, std::memory_order_release);
+	return true;
 }
-float ChessAI_V1_MCST::Rollout(Node* node) 
+float ChessAI_V1_MCST::Rollout(ChessBoard& chessBoard, uint64_t& randomState) 
 {
-	//int moveCounter{};
-	//while (m_pChessBoard->GetGameProgress() == GameProgress::InProgress) 
-	//{
-	//	auto possibleMoves = m_pChessBoard->GetPossibleMoves();
-	//	if (possibleMoves.empty()) break;
-	//
-	//	int randomIndex = rand() % possibleMoves.size();
-	//	auto it{ possibleMoves.begin() };
-	//	std::advance(it, randomIndex);
-	//
-	//	m_pChessBoard->MakeMove(*it);
-	//	++moveCounter;
-	//}
+	const GameState& gameState{ chessBoard.GetCurrentGameState(false) };
+	if (m_PlayoutDepth == 0 || gameState.gameProgress != GameProgress::InProgress) return BoardValueEvaluation(gameState);
+
+	// Played out on a stripped-down copy, the board itself stays at the leaf
+	PlayoutBoard playoutBoard{ gameState };
+	const PlayoutPolicy playoutPolicy{ m_SearchFeatures.capturesFirstPlayouts ? PlayoutPolicy::CapturesFirst : PlayoutPolicy::Random };
+	ThreadStatistics& threadStatistics{ GetThreadStatistics() };
+	Count(threadStatistics.playoutPlyCount, playoutBoard.Playout(m_PlayoutDepth, playoutPolicy, randomState));
+	Count(threadStatistics.playoutCount);
 
 	// Evaluate the final position using a simple heuristic
-	float evalValue = BoardValueEvaluation(node->gameState);
-	//m_pChessBoard->UnMakeLastMove(moveCounter);
-	return evalValue;
+	return BoardValueEvaluation(playoutBoard.GetGameState());
 }
-void ChessAI_V1_MCST::Backpropagate(Node* node, float score) {
-	while (node != nullptr) 
+void ChessAI_V1_MCST::Backpropagate(int nodeIndex, float score, ChessBoard& chessBoard) {
+	while (nodeIndex != -1) 
 	{
-		++node->visits;
-		node->totalScore += score;
-		node = node->parent;
+		Node& node{ m_NodePool[nodeIndex] };
+		++node.visits;
+		node.totalScore += score;
+		nodeIndex = node.parentIndex;
+
+		// Every node but the root was reached with a move, and took a virtual loss on the way down
+		if (nodeIndex != -1)
+		{
+			--node.virtualLosses;
+			chessBoard.UnMakeLastMove();
+		}
 	}
 }
 
 #pragma endregion
+
+std::unique_ptr<ChessAI> CreateChessAI(const std::string& name, ChessBoard* pChessBoard, bool controllingWhite, int transpositionTableSizeInMB)
+{
+	if (name == "V0") return std::make_unique<ChessAI_V0>(pChessBoard, controllingWhite);
+	if (name == "V1") return std::make_unique<ChessAI_V1_AlphaBeta>(pChessBoard, controllingWhite, transpositionTableSizeInMB);
+	if (name == "V2") return std::make_unique<ChessAI_V2_AlphaBeta>(pChessBoard, controllingWhite, transpositionTableSizeInMB);
+	if (name == "V3") return std::make_unique<ChessAI_V3_AlphaBeta>(pChessBoard, controllingWhite, transpositionTableSizeInMB);
+	if (name == "MCST") return std::make_unique<ChessAI_V1_MCST>(pChessBoard, controllingWhite);
+	return nullptr;
+}
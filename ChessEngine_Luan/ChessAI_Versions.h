@@ -1,6 +1,12 @@
 #pragma once
 #include "ChessAI.h"
 #include "ChessAIHelpers.h"
+#include "PieceSquareTables.h"
+#include "MoveOrdering.h"
+#include "PrincipalVariationTable.h"
+#include <cmath>
+#include <memory>
+#include <string>
 
 class ChessAI_V0 final : public ChessAI
 {
@@ -21,10 +27,79 @@ public:
 
 #pragma region AlphaBeta
 
-class ChessAI_V1_AlphaBeta final : public ChessAI
+// The negamax search the alpha-beta versions share. They differ in their evaluation and in what a pawn is worth in it
+class ChessAI_AlphaBeta : public ChessAI
 {
 public:
-	ChessAI_V1_AlphaBeta(ChessBoard* chessBoard, bool controllingWhite) : ChessAI(chessBoard, controllingWhite) {};
+	virtual ~ChessAI_AlphaBeta() = default;
+
+	// Being mated ply plies from the root scores -(s_MateValue - ply), so a shorter mate scores better. Far beyond any evaluation,
+	// and a search never gets s_MaxMatePly deep, so every score past s_MateValue - s_MaxMatePly is a mate
+	static constexpr float s_MateValue{ 1000000.f };
+	static constexpr int s_MaxMatePly{ 1000 };
+	static bool IsMateValue(float value) { return std::abs(value) >= s_MateValue - s_MaxMatePly; }
+
+	ChessAI_AlphaBeta(const ChessAI_AlphaBeta& other) = delete;
+	ChessAI_AlphaBeta(ChessAI_AlphaBeta&& other) = delete;
+	ChessAI_AlphaBeta& operator=(const ChessAI_AlphaBeta& other) = delete;
+	ChessAI_AlphaBeta& operator=(ChessAI_AlphaBeta&& other) noexcept = delete;
+
+protected:
+	// What one search thread works on, every Lazy SMP thread has its own board, killers, history and principal variation
+	struct SearchThreadData
+	{
+		ChessBoard& chessBoard;
+		MoveOrdering& moveOrdering;
+		PrincipalVariationTable& principalVariation;
+	};
+	// What the pruning found out about a node that is off the principal variation and not in check
+	struct NodePruning
+	{
+		// The node gets cut off with value, without searching its moves
+		bool isPruned{};
+		float value{};
+		// Quiet moves after the first can't lift the node up to alpha, so they get skipped
+		bool canPruneQuietMoves{};
+	};
+
+	// pawnValue is what a pawn is worth in the evaluation, deltaMargin how much the position can add to a capture before delta pruning skips it.
+	// An evaluation that reads the possible moves of the GameState has them generated at every leaf
+	ChessAI_AlphaBeta(ChessBoard* chessBoard, bool controllingWhite, int transpositionTableSizeInMB, float pawnValue, float deltaMargin, bool evaluatesPossibleMoves)
+		: ChessAI(chessBoard, controllingWhite), m_PawnValue{ pawnValue }, m_DeltaMargin{ deltaMargin }, m_EvaluatesPossibleMoves{ evaluatesPossibleMoves }
+	{
+		m_TranspositionTable.Resize(transpositionTableSizeInMB);
+	};
+
+	// The evaluation from the view of the side to move
+	float EvaluateForSideToMove(ChessBoard& chessBoard);
+
+	// Searches the root moves in their order and returns the best, bestValue gets its score.
+	// After a stop it only counts the moves that were fully searched
+	Move SearchRoot(int depth, float alpha, float beta, const MoveList& rootMoves, SearchThreadData& thread, float& bestValue);
+	// Negamax principal variation search with the transposition table, every value is from the view of the side to move
+	float DepthSearch(int depth, int ply, float alpha, float beta, SearchThreadData& thread);
+	// Plays out the captures, or every evasion when in check, until the position is quiet enough to evaluate
+	float Quiescence(float alpha, float beta, int ply, ChessBoard& chessBoard);
+
+	// Extensions and pruning, only V3 has them. By default every move gets searched to the full depth
+	virtual int GetExtension(int ply, bool isInCheck) { return 0; }
+	virtual NodePruning PruneNode(int depth, int ply, float alpha, float beta, SearchThreadData& thread) { return NodePruning{}; }
+	// Only asked for the quiet moves after the first that don't give check and aren't played out of check
+	virtual int GetReduction(int depth, int moveNumber, bool isPrincipalVariationNode) { return 0; }
+
+	virtual void ConvertScore(float score, SearchInfo& searchInfo) override;
+
+private:
+	const float m_PawnValue;
+	const float m_DeltaMargin;
+	const bool m_EvaluatesPossibleMoves;
+};
+
+class ChessAI_V1_AlphaBeta final : public ChessAI_AlphaBeta
+{
+public:
+	ChessAI_V1_AlphaBeta(ChessBoard* chessBoard, bool controllingWhite, int transpositionTableSizeInMB = 16)
+		: ChessAI_AlphaBeta(chessBoard, controllingWhite, transpositionTableSizeInMB, s_PawnValue, s_DeltaMargin, false) {};
 	~ChessAI_V1_AlphaBeta() = default;
 
 	ChessAI_V1_AlphaBeta(const ChessAI_V1_AlphaBeta& other) = delete;
@@ -36,14 +111,23 @@ public:
 	virtual Move GetAIMove() override;
 	
 private:
-	float DepthSearch(int depth, float alpha, float beta);
-	virtual float BoardValueEvaluation(GameState gameState) override;
+	// What a pawn is worth in the evaluation, and how much the position can add to a capture before delta pruning skips it
+	static constexpr float s_PawnValue{ 1.f };
+	static constexpr float s_DeltaMargin{ 2.f };
+
+	// Killers, history and principal variation of the last GetAIMove only
+	MoveOrdering m_MoveOrdering{};
+	PrincipalVariationTable m_PrincipalVariation{};
+
+	virtual float BoardValueEvaluation(const GameState& gameState) override;
 };
 
-class ChessAI_V2_AlphaBeta final : public ChessAI
+class ChessAI_V2_AlphaBeta final : public ChessAI_AlphaBeta
 {
 public:
-	ChessAI_V2_AlphaBeta(ChessBoard* chessBoard, bool controllingWhite) : ChessAI(chessBoard, controllingWhite) {};
+	// The move balance of the evaluation counts the possible moves
+	ChessAI_V2_AlphaBeta(ChessBoard* chessBoard, bool controllingWhite, int transpositionTableSizeInMB = 16)
+		: ChessAI_AlphaBeta(chessBoard, controllingWhite, transpositionTableSizeInMB, s_PawnValue, s_DeltaMargin, true) {};
 	~ChessAI_V2_AlphaBeta() = default;
 
 	ChessAI_V2_AlphaBeta(const ChessAI_V2_AlphaBeta& other) = delete;
@@ -55,24 +139,24 @@ public:
 
 private:
 
+	static constexpr float s_PawnValue{ 100.f };
+	static constexpr float s_DeltaMargin{ 200.f };
+
 	const float m_MoveAmountValue{ 10.f };
 	const int m_MoveAmountOffset{ 20 };
-	const PieceSquareTables m_PieceTables{};
 
-	float DepthSearch(int depth, float alpha, float beta, ChessBoard* pChessBoard);
-	virtual float BoardValueEvaluation(GameState gameState) override;
+	virtual float BoardValueEvaluation(const GameState& gameState) override;
 
 
-	float MaterialBalance(GameState gameState);
-	float MoveBalance(GameState gameState);
-
-
-	int AmountOfPieces(uint64_t bitBoard);
+	// The tapered piece square tables in centipawns
+	int MaterialBalance(const GameState& gameState);
+	float MoveBalance(const GameState& gameState);
 };
-class ChessAI_V3_AlphaBeta final : public ChessAI
+class ChessAI_V3_AlphaBeta final : public ChessAI_AlphaBeta
 {
 public:
-	ChessAI_V3_AlphaBeta(ChessBoard* chessBoard, bool controllingWhite) : ChessAI(chessBoard, controllingWhite) {};
+	ChessAI_V3_AlphaBeta(ChessBoard* chessBoard, bool controllingWhite, int transpositionTableSizeInMB = 16)
+		: ChessAI_AlphaBeta(chessBoard, controllingWhite, transpositionTableSizeInMB, s_PawnValue, s_DeltaMargin, false) {};
 	~ChessAI_V3_AlphaBeta() = default;
 
 	ChessAI_V3_AlphaBeta(const ChessAI_V3_AlphaBeta& other) = delete;
@@ -84,6 +168,10 @@ public:
 
 private:
 
+	// The piece square tables count a pawn as about 100, and the material balance gets doubled
+	static constexpr float s_PawnValue{ 200.f };
+	static constexpr float s_DeltaMargin{ 400.f };
+
 	const float m_MaterialBalanceMult{2.f};
 	const float m_MaterialConsiderationsMult{15.f};
 	const float m_DevelopmentMult{15.f};
@@ -92,21 +180,40 @@ private:
 	const float m_IsolatedPawnsMult{35.f};
 	const float m_PassedPawnsMult{35.f};
 
-	const PieceSquareTables m_PieceTables{};
+	// Only reached when a time limit stops the iterative deepening
+	static constexpr int s_MaxSearchDepth{ 64 };
+	// A quarter of a pawn on both sides of the score of the depth before, past s_MaxAspirationWindow the window opens up fully
+	static constexpr int s_AspirationMinDepth{ 4 };
+	static constexpr float s_AspirationWindow{ 50.f };
+	static constexpr float s_MaxAspirationWindow{ 1000.f };
 
-	float DepthSearch(int depth, float alpha, float beta, ChessBoard* pChessBoard);
-	virtual float BoardValueEvaluation(GameState gameState) override;
+	// Margins per ply of depth left, in the units of the evaluation
+	static constexpr int s_ReverseFutilityMaxDepth{ 3 };
+	static constexpr float s_ReverseFutilityMargin{ 150.f };
+	static constexpr int s_FutilityMaxDepth{ 2 };
+	static constexpr float s_FutilityMargin{ 250.f };
+	static constexpr int s_NullMoveMinDepth{ 3 };
+	static constexpr int s_NullMoveReduction{ 2 };
+	static constexpr int s_LateMoveReductionMinDepth{ 3 };
+	static constexpr int s_LateMoveReductionMinMoves{ 3 };
 
+	// Check extension, reverse futility, null move and futility pruning and late move reductions, each one can be switched off
+	virtual int GetExtension(int ply, bool isInCheck) override;
+	virtual NodePruning PruneNode(int depth, int ply, float alpha, float beta, SearchThreadData& thread) override;
+	virtual int GetReduction(int depth, int moveNumber, bool isPrincipalVariationNode) override;
+	virtual float BoardValueEvaluation(const GameState& gameState) override;
 
-	float MaterialBalance(GameState gameState);
-	float MaterialConsiderations(GameState gameState);
 
-	float PawnStructure(GameState gameState);
-	float DoubledPawns(GameState gameState);
-	float IsolatedPawns(GameState gameState);
-	float PassedPawns(GameState gameState);
+	// The tapered piece square tables in centipawns
+	int MaterialBalance(const GameState& gameState);
+	float MaterialConsiderations(const GameState& gameState);
 
-	float Development(GameState gameState);
+	float PawnStructure(const GameState& gameState);
+	float DoubledPawns(const GameState& gameState);
+	float IsolatedPawns(const GameState& gameState);
+	float PassedPawns(const GameState& gameState);
+
+	float Development(const GameState& gameState);
 
 
 	int AmountOfPieces(uint64_t bitBoard);
@@ -133,18 +240,36 @@ public:
 	
 private:
 
+	// Only without a time limit, with one the tree grows until the time is up
 	int m_Iterations{3000};
+	NodePool m_NodePool{};
+	// The position the root of m_NodePool stands for
+	uint64_t m_TreeZobristKey{};
 
-	virtual float BoardValueEvaluation(GameState gameState) override;
+	virtual float BoardValueEvaluation(const GameState& gameState) override;
 	
 
-	Node* SelectNode(Node* node);
-	void ExpandNode(Node* node);
-	float Rollout(Node* node);
-	void Backpropagate(Node* node, float score);
+	// Makes the grandchild for the last two moves of the game the new root. False when the tree doesn't have it
+	bool ReuseTree();
+	// What every thread that is still on its way down through a node counts as, from the view of the side choosing it
+	static constexpr float s_VirtualLoss{ 1.f };
+
+	// Walks down from the node making the moves on the board, so it is left at the position of the returned node.
+	// Every node it goes through takes a virtual loss until Backpropagate
+	int SelectNode(int nodeIndex, ChessBoard& chessBoard);
+	// Gives the node a child for every move of the board's position. False when it has no moves, they don't fit
+	// in the pool or another thread expands it already
+	bool ExpandNode(int nodeIndex, ChessBoard& chessBoard);
+	// Plays the board's position out for up to m_PlayoutDepth moves and scores where that ends
+	float Rollout(ChessBoard& chessBoard, uint64_t& randomState);
+	// Walks back up to the root, taking the moves and the virtual losses back on the way
+	void Backpropagate(int nodeIndex, float score, ChessBoard& chessBoard);
 
 
 
 };
 
-#pragma endregion
\ No newline at end of file
+#pragma endregion
+
+// Names: V0, V1, V2, V3, MCST. Returns nullptr for an unknown name
+std::unique_ptr<ChessAI> CreateChessAI(const std::string& name, ChessBoard* pChessBoard, bool controllingWhite, int transpositionTableSizeInMB = 16);
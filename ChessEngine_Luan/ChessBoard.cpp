@@ -1,15 +1,15 @@
 #include "ChessBoard.h"
-#include "GameEngine.h"
+#include "BitUtilities.h"
+#include "MagicBitBoards.h"
+#include "PieceSquareTables.h"
+#include "Zobrist.h"
 #include <string>
 #include <cassert>
-#include <cmath>
+#include <cstdlib>
+#include <algorithm>
 
 ChessBoard::ChessBoard()
 {
-	//m_PossibleMoves.resize(218);
-	m_GameStateHistory.resize(4000); // 269 is longest tournament game played, but for search reasons I use 4000
-
-
 	std::string FEN{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" };
 	//std::string FEN{ "rnbqk1nr/ppp2ppp/3bp3/3p4/3P4/2N2N2/PPP1PPPP/R1BQKB1R w KQkq - 0 1" };
 	
@@ -33,125 +33,224 @@ ChessBoard::ChessBoard()
 	//std::string FEN{ "K1k5/8/P7/8/8/8/8/8 w - - 0 1" }; // Self Stalemate						Depth : 6 = 2217		// 
 	//std::string FEN{ "8/k1P5/8/1K6/8/8/8/8 w - - 0 1" }; // Stalemate & Checkmate 1			Depth : 7 = 567584		// 
 	//std::string FEN{ "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1" }; // Stalemate & Checkmate 2		Depth : 4 = 23527		// 
+	Initialize(FEN);
+}
+ChessBoard::ChessBoard(const std::string& FEN)
+{
+	Initialize(FEN);
+}
+void ChessBoard::Initialize(const std::string& FEN)
+{
+	m_UndoHistory.resize(4000); // 269 is longest tournament game played, but for search reasons I use 4000
+
 	SetBitboardsFromFEN(FEN);
+	m_ZobristKey = CalculateZobristKey();
+	m_PieceSquareScore = PieceSquareTables::CalculateScore(m_BitBoards);
 	
 	UpdateColorBitboards();
+	m_SquareAttacksHistory.clear();
+	RecalculateSquareAttacks();
 	UpdateThreatMap({}, false);
 	CalculatePossibleMoves();
 
-	UpdateGameStateHistory();
 	m_CurrentOwnThreatMap;
 }
 
-int ChessBoard::StartMoveGenerationTest(int depth)
+void ChessBoard::MakeMove(Move move)
 {
-	m_TotalAmount = 0;
-	m_CaptureAmount = 0;
-	m_EnPassantAmount = 0;
-	m_CastleAmount = 0;
-	m_PromotionAmount = 0;
-	m_CheckAmount = 0;
+	if (move.GetMoveType() == MoveType::NullMove) return;
+
+	if (m_GameProgress != GameProgress::InProgress) { PushUndoRecord(); m_PossibleMoves.clear(); m_ArePossibleMovesStale = false; return; }
+
+	PlayMove(move);
+
+	!m_WhiteToMove ? m_BitBoards.whiteThreatMap = 0 : m_BitBoards.blackThreatMap = 0;
+	UpdateThreatMap(move);
+	UpdatePinnedBoards();
 
-	return MoveGenerationTest(depth, depth);
+	CalculatePossibleMoves();
+	m_ArePossibleMovesStale = false;
+	
+	CheckForGameEnd();
 }
-int ChessBoard::MoveGenerationTest(int depth, int initialDepth)
+bool ChessBoard::MakePseudoLegalMove(Move move)
 {
-	if (depth == 0) return 1;
+	if (move.GetMoveType() == MoveType::NullMove || m_GameProgress != GameProgress::InProgress) return false;
 
-	int positionsCounter{};
-	for (int index{}; index < m_PossibleMoves.size(); ++index)
-	{
+	PlayMove(move);
 
-		auto it{ m_PossibleMoves.begin() };
-		std::advance(it, index);
-		Move move{ *it };
+	// The side that just moved can't leave its own king in check
+	uint64_t movedKingBitBoard{ m_WhiteToMove ? m_BitBoards.blackKing : m_BitBoards.whiteKing };
+	if (movedKingBitBoard && IsSquareAttacked(BitUtilities::GetLsb(movedKingBitBoard), m_WhiteToMove))
+	{
+		UnMakeLastMove();
+		return false;
+	}
 
-		if (move.moveType == MoveType::Capture || move.moveType == MoveType::BishopPromotionCapture || move.moveType == MoveType::KnightPromotionCapture || move.moveType == MoveType::RookPromotionCapture || move.moveType == MoveType::QueenPromotionCapture || move.moveType == MoveType::EnPassantCaptureLeft || move.moveType == MoveType::EnPassantCaptureRight)
-			++m_CaptureAmount;
+	// Double check only matters to the legal move generation, which works it out again from the threat maps
+	uint64_t kingBitBoard{ m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing };
+	m_IsKingInCheck = kingBitBoard && IsSquareAttacked(BitUtilities::GetLsb(kingBitBoard), !m_WhiteToMove);
+	m_IsKingInDoubleCheck = false;
 
-		if (move.moveType == MoveType::EnPassantCaptureLeft || move.moveType == MoveType::EnPassantCaptureRight)
-			++m_EnPassantAmount;
+	m_ArePossibleMovesStale = true;
 
-		if (move.moveType == MoveType::KingCastle || move.moveType == MoveType::QueenCastle)
-			++m_CastleAmount;
+	CheckForDraw();
+	return true;
+}
+void ChessBoard::MakeNullMove()
+{
+	// The record's move stays a NullMove, isNullMove tells it apart from the records of moves made after the game ended
+	UndoRecord& undoRecord{ PushUndoRecord() };
+	undoRecord.isNullMove = true;
 
-		if (move.moveType == MoveType::BishopPromotion || move.moveType == MoveType::KnightPromotion || move.moveType == MoveType::RookPromotion || move.moveType == MoveType::QueenPromotion || move.moveType == MoveType::BishopPromotionCapture || move.moveType == MoveType::KnightPromotionCapture || move.moveType == MoveType::RookPromotionCapture || move.moveType == MoveType::QueenPromotionCapture)
-			++m_PromotionAmount;
+	m_WhiteToMove = !m_WhiteToMove;
+	++m_FullMoveCounter;
+	// A pass isn't a pawn move or capture, so the fifty-move count goes on. CheckForRepetition stops at the pass by itself
 
-		
+	m_ZobristKey ^= Zobrist::GetSideToMoveKey() ^ Zobrist::GetEnPassantKey(m_EnPassantSquares);
+	m_EnPassantSquares = 0;
 
-		MakeMove(move);
+	// The side that passed wasn't in check, so the side to move now can't be either
+	m_IsKingInCheck = false;
+	m_IsKingInDoubleCheck = false;
 
-		if (m_IsKingInCheck) ++m_CheckAmount;
+	m_ArePossibleMovesStale = true;
+}
+void ChessBoard::UnMakeLastMove(int customDepth)
+{
+	if (m_UndoHistoryCounter - customDepth < 0) return;
 
-		int amount{ MoveGenerationTest(depth - 1, initialDepth) };
-		positionsCounter += amount;
-		if(depth == 1)
-			m_TotalAmount += amount;
-		
-		UnMakeLastMove();
+	for (int index{}; index < customDepth; ++index)
+	{
+		UnMakeMove(m_UndoHistory[--m_UndoHistoryCounter]);
 	}
-
-	return positionsCounter;
+	m_ArePossibleMovesStale = true;
 }
-
-void ChessBoard::MakeMove(Move move)
+void ChessBoard::PlayMove(Move move)
 {
-	if (move.moveType == MoveType::NullMove) return;
-	if (m_GameProgress != GameProgress::InProgress) { m_PossibleMoves.clear(); UpdateGameStateHistory(); return; }
+	UndoRecord& undoRecord{ PushUndoRecord() };
+
+	undoRecord.move = move;
+	undoRecord.capturedPieceIndex = static_cast<int8_t>(GetPieceIndexFromSquare(GetCapturedSquareIndex(move)));
+
+	const BitBoards previousBitBoards{ m_BitBoards };
+	int previousCastlingRightsMask{ GetCastlingRightsMask() };
+	uint64_t previousEnPassantSquares{ m_EnPassantSquares };
+
 	m_WhiteToMove = !m_WhiteToMove;
 
-	if(m_WhiteToMove) ++m_HalfMoveClock;
+	++m_HalfMoveClock;
 	++m_FullMoveCounter;
 	
 	m_EnPassantSquares = 0;
 
-	uint64_t* startBitBoard{GetBitboardFromSquare(move.startSquareIndex)};
-	CheckCastleRights(*startBitBoard, move.startSquareIndex);
+	uint64_t* startBitBoard{GetBitboardFromSquare(move.GetStartSquareIndex())};
+	CheckCastleRights(*startBitBoard, move.GetStartSquareIndex());
 	
 	UpdateBitBoards(move, startBitBoard);
-	CalculatePossibleMoves();
-	
-	CheckForGameEnd();
 
-	UpdateGameStateHistory();
+	m_ZobristKey ^= Zobrist::GetPiecesDifferenceKey(previousBitBoards, m_BitBoards) ^ Zobrist::GetSideToMoveKey();
+	m_ZobristKey ^= Zobrist::GetCastlingKey(previousCastlingRightsMask) ^ Zobrist::GetCastlingKey(GetCastlingRightsMask());
+	m_ZobristKey ^= Zobrist::GetEnPassantKey(previousEnPassantSquares) ^ Zobrist::GetEnPassantKey(m_EnPassantSquares);
+
+	m_PieceSquareScore += PieceSquareTables::GetPiecesDifferenceScore(previousBitBoards, m_BitBoards);
+	// Debug builds check the running sums against a full recount after every move
+	assert(m_PieceSquareScore == PieceSquareTables::CalculateScore(m_BitBoards));
+
+	undoRecord.changedSquares = (previousBitBoards.whitePieces ^ m_BitBoards.whitePieces) | (previousBitBoards.blackPieces ^ m_BitBoards.blackPieces);
 }
-void ChessBoard::UnMakeLastMove(int customDepth)
+UndoRecord& ChessBoard::PushUndoRecord()
 {
-	if (m_GameStateHistoryCounter - customDepth < 0) return;
-	m_GameStateHistoryCounter -= customDepth;
-	GameState gameState = m_GameStateHistory[m_GameStateHistoryCounter];
+	UndoRecord& undoRecord{ m_UndoHistory[m_UndoHistoryCounter++] };
+
+	undoRecord.zobristKey = m_ZobristKey;
+	undoRecord.enPassantSquares = m_EnPassantSquares;
+	undoRecord.checkRay = m_BitBoards.checkRay;
+	undoRecord.pieceSquareScore = m_PieceSquareScore;
+
+	undoRecord.halfMoveClock = m_HalfMoveClock;
+	undoRecord.gameProgress = m_GameProgress;
 
-	m_GameProgress = gameState.gameProgress;
+	undoRecord.move = Move{};
+	undoRecord.capturedPieceIndex = -1;
+	undoRecord.castlingRightsMask = static_cast<uint8_t>(GetCastlingRightsMask());
 
-	m_BitBoards = gameState.bitBoards;
-	m_PossibleMoves = gameState.possibleMoves;
+	undoRecord.isKingInCheck = m_IsKingInCheck;
+	undoRecord.isKingInDoubleCheck = m_IsKingInDoubleCheck;
+	undoRecord.isNullMove = false;
+	undoRecord.changedSquares = 0;
+	undoRecord.savedSquareAttacks = 0;
+
+	return undoRecord;
+}
+void ChessBoard::UnMakeMove(const UndoRecord& undoRecord)
+{
+	const bool areSquareAttacksUpToDate{ m_SquareAttacksZobristKey == m_ZobristKey };
 
-	m_WhiteToMove = gameState.whiteToMove;
+	m_ZobristKey = undoRecord.zobristKey;
+	m_EnPassantSquares = undoRecord.enPassantSquares;
+	m_BitBoards.checkRay = undoRecord.checkRay;
+	m_PieceSquareScore = undoRecord.pieceSquareScore;
 
-	m_WhiteCanCastleKingSide = gameState.whiteCanCastleKingSide;
-	m_WhiteCanCastleQueenSide = gameState.whiteCanCastleQueenSide;
-	m_BlackCanCastleKingSide = gameState.blackCanCastleKingSide;
-	m_BlackCanCastleQueenSide = gameState.blackCanCastleQueenSide;
+	m_HalfMoveClock = undoRecord.halfMoveClock;
+	m_GameProgress = undoRecord.gameProgress;
 
-	m_EnPassantSquares = gameState.enPassantSquares;
-	m_HalfMoveClock = gameState.halfMoveClock;
-	m_FullMoveCounter = gameState.fullMoveCounter;
+	m_WhiteCanCastleKingSide = undoRecord.castlingRightsMask & 1;
+	m_WhiteCanCastleQueenSide = undoRecord.castlingRightsMask & 2;
+	m_BlackCanCastleKingSide = undoRecord.castlingRightsMask & 4;
+	m_BlackCanCastleQueenSide = undoRecord.castlingRightsMask & 8;
 
+	m_IsKingInCheck = undoRecord.isKingInCheck;
+	m_IsKingInDoubleCheck = undoRecord.isKingInDoubleCheck;
+
+	if (undoRecord.isNullMove)
+	{
+		m_WhiteToMove = !m_WhiteToMove;
+		--m_FullMoveCounter;
+		return;
+	}
+	// Moves made after the game ended only pushed a record, they never changed the position
+	if (undoRecord.move.GetMoveType() == MoveType::NullMove) return;
+
+	m_WhiteToMove = !m_WhiteToMove;
+	--m_FullMoveCounter;
+
+	RestoreBitBoards(undoRecord.move, undoRecord.capturedPieceIndex);
+	assert(m_PieceSquareScore == PieceSquareTables::CalculateScore(m_BitBoards));
+
+	// Square attacks that were up to date stay that way, the search's own moves never bring them up to date to begin with.
+	// Only when they were recalculated from scratch there is nothing saved to put back
+	if (areSquareAttacksUpToDate)
+	{
+		if (undoRecord.savedSquareAttacks) RestoreSquareAttacks(undoRecord.savedSquareAttacks);
+		else UpdateSquareAttacks(undoRecord.changedSquares);
+		m_SquareAttacksZobristKey = undoRecord.zobristKey;
+	}
+}
+void ChessBoard::UpdateStalePossibleMoves()
+{
+	if (!m_ArePossibleMovesStale) return;
+
+	// Same steps MakeMove takes after moving the pieces, the threat map of the side that just moved is built from scratch
+	!m_WhiteToMove ? m_BitBoards.whiteThreatMap = 0 : m_BitBoards.blackThreatMap = 0;
+	UpdateThreatMap({}, false);
+	UpdatePinnedBoards();
+	CalculatePossibleMoves();
+
+	m_ArePossibleMovesStale = false;
 }
 
 void ChessBoard::UpdateBitBoards(Move move, uint64_t* startBitBoard)
 {
-	!m_WhiteToMove ? m_BitBoards.whiteThreatMap = 0 : m_BitBoards.blackThreatMap = 0;
-	
+	int startSquareIndex{ move.GetStartSquareIndex() };
+	int targetSquareIndex{ move.GetTargetSquareIndex() };
 	
-	
-	switch (move.moveType)
+	switch (move.GetMoveType())
 	{
 		case MoveType::QuietMove:
 		{
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex];
-			*startBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex];
+			*startBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			if (*startBitBoard == m_BitBoards.whitePawns || *startBitBoard == m_BitBoards.blackPawns) m_HalfMoveClock = 0;
 
@@ -159,66 +258,66 @@ void ChessBoard::UpdateBitBoards(Move move, uint64_t* startBitBoard)
 		}
 		case MoveType::DoublePawnPush:
 		{
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
-			*startBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
-			m_EnPassantSquares |= m_BitMasks.bitMasks[move.startSquareIndex + (move.targetSquareIndex - move.startSquareIndex) / 2];
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
+			*startBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
+			m_EnPassantSquares |= m_BitMasks.bitMasks[startSquareIndex + (targetSquareIndex - startSquareIndex) / 2];
 
 			m_HalfMoveClock = 0;
 			break;
 		}
 		case MoveType::KingCastle:
 		{
-			uint64_t* rookBitBoard{ GetBitboardFromSquare(move.targetSquareIndex + 1) };
-			*rookBitBoard ^= m_BitMasks.bitMasks[move.targetSquareIndex + 1];
-			*rookBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex - 1];
+			uint64_t* rookBitBoard{ GetBitboardFromSquare(targetSquareIndex + 1) };
+			*rookBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex + 1];
+			*rookBitBoard |= m_BitMasks.bitMasks[targetSquareIndex - 1];
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
-			*startBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
+			*startBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			break;
 		}
 		case MoveType::QueenCastle:
 		{
-			uint64_t* rookBitBoard{ GetBitboardFromSquare(move.targetSquareIndex - 2) };
-			*rookBitBoard ^= m_BitMasks.bitMasks[move.targetSquareIndex - 2];
-			*rookBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex + 1];
+			uint64_t* rookBitBoard{ GetBitboardFromSquare(targetSquareIndex - 2) };
+			*rookBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex - 2];
+			*rookBitBoard |= m_BitMasks.bitMasks[targetSquareIndex + 1];
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex];
-			*startBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex];
+			*startBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			break;
 		}
 		case MoveType::Capture:
 		{
-			uint64_t* targetBitBoard{ GetBitboardFromSquare(move.targetSquareIndex) };
-			*targetBitBoard ^= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			uint64_t* targetBitBoard{ GetBitboardFromSquare(targetSquareIndex) };
+			*targetBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] ;
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
-			*startBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
+			*startBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
 		}
 		case MoveType::EnPassantCaptureLeft:
 		{
-			uint64_t* targetBitBoard{ GetBitboardFromSquare((move.targetSquareIndex + (move.startSquareIndex - move.targetSquareIndex - 1))) };
-			*targetBitBoard ^= m_BitMasks.bitMasks[(move.targetSquareIndex + (move.startSquareIndex - move.targetSquareIndex - 1))] ;
+			uint64_t* targetBitBoard{ GetBitboardFromSquare((targetSquareIndex + (startSquareIndex - targetSquareIndex - 1))) };
+			*targetBitBoard ^= m_BitMasks.bitMasks[(targetSquareIndex + (startSquareIndex - targetSquareIndex - 1))] ;
 
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
-			*startBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
+			*startBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
 		}
 		case MoveType::EnPassantCaptureRight:
 		{
-			uint64_t* targetBitBoard{ GetBitboardFromSquare((move.targetSquareIndex + (move.startSquareIndex - move.targetSquareIndex + 1))) };
-			*targetBitBoard ^= m_BitMasks.bitMasks[(move.targetSquareIndex + (move.startSquareIndex - move.targetSquareIndex + 1))] ;
+			uint64_t* targetBitBoard{ GetBitboardFromSquare((targetSquareIndex + (startSquareIndex - targetSquareIndex + 1))) };
+			*targetBitBoard ^= m_BitMasks.bitMasks[(targetSquareIndex + (startSquareIndex - targetSquareIndex + 1))] ;
 
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
-			*startBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
+			*startBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
@@ -226,9 +325,9 @@ void ChessBoard::UpdateBitBoards(Move move, uint64_t* startBitBoard)
 		case MoveType::KnightPromotion:
 		{
 			uint64_t* knightBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteKnights : &m_BitBoards.blackKnights };
-			*knightBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex];
+			*knightBitBoard |= m_BitMasks.bitMasks[targetSquareIndex];
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
@@ -236,9 +335,9 @@ void ChessBoard::UpdateBitBoards(Move move, uint64_t* startBitBoard)
 		case MoveType::BishopPromotion:
 		{
 			uint64_t* bishopBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteBishops : &m_BitBoards.blackBishops };
-			*bishopBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*bishopBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
@@ -246,9 +345,9 @@ void ChessBoard::UpdateBitBoards(Move move, uint64_t* startBitBoard)
 		case MoveType::RookPromotion:
 		{
 			uint64_t* rookBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteRooks : &m_BitBoards.blackRooks };
-			*rookBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*rookBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
@@ -256,61 +355,61 @@ void ChessBoard::UpdateBitBoards(Move move, uint64_t* startBitBoard)
 		case MoveType::QueenPromotion:
 		{
 			uint64_t* queenBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteQueens : &m_BitBoards.blackQueens };
-			*queenBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*queenBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
 		}
 		case MoveType::KnightPromotionCapture:
 		{
-			uint64_t* targetBitBoard{ GetBitboardFromSquare(move.targetSquareIndex) };
-			*targetBitBoard ^= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			uint64_t* targetBitBoard{ GetBitboardFromSquare(targetSquareIndex) };
+			*targetBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			uint64_t* knightBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteKnights : &m_BitBoards.blackKnights };
-			*knightBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*knightBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
 		}
 		case MoveType::BishopPromotionCapture:
 		{
-			uint64_t* targetBitBoard{ GetBitboardFromSquare(move.targetSquareIndex) };
-			*targetBitBoard ^= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			uint64_t* targetBitBoard{ GetBitboardFromSquare(targetSquareIndex) };
+			*targetBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			uint64_t* bishopBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteBishops : &m_BitBoards.blackBishops };
-			*bishopBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*bishopBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
 		}
 		case MoveType::RookPromotionCapture:
 		{
-			uint64_t* targetBitBoard{ GetBitboardFromSquare(move.targetSquareIndex) };
-			*targetBitBoard ^= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			uint64_t* targetBitBoard{ GetBitboardFromSquare(targetSquareIndex) };
+			*targetBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			uint64_t* rookBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteRooks : &m_BitBoards.blackRooks };
-			*rookBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			*rookBitBoard |= m_BitMasks.bitMasks[targetSquareIndex] ;
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
 		}
 		case MoveType::QueenPromotionCapture:
 		{
-			uint64_t* targetBitBoard{ GetBitboardFromSquare(move.targetSquareIndex) };
-			*targetBitBoard ^= m_BitMasks.bitMasks[move.targetSquareIndex] ;
+			uint64_t* targetBitBoard{ GetBitboardFromSquare(targetSquareIndex) };
+			*targetBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] ;
 
 			uint64_t* queenBitBoard{ (*startBitBoard & m_BitBoards.whitePieces) ? &m_BitBoards.whiteQueens : &m_BitBoards.blackQueens };
-			*queenBitBoard |= m_BitMasks.bitMasks[move.targetSquareIndex];
+			*queenBitBoard |= m_BitMasks.bitMasks[targetSquareIndex];
 
-			*startBitBoard ^= m_BitMasks.bitMasks[move.startSquareIndex] ;
+			*startBitBoard ^= m_BitMasks.bitMasks[startSquareIndex] ;
 
 			m_HalfMoveClock = 0;
 			break;
@@ -319,8 +418,58 @@ void ChessBoard::UpdateBitBoards(Move move, uint64_t* startBitBoard)
 	}
 
 	UpdateColorBitboards();
-	UpdateThreatMap(move);
-	UpdatePinnedBoards();
+}
+void ChessBoard::RestoreBitBoards(Move move, int capturedPieceIndex)
+{
+	int startSquareIndex{ move.GetStartSquareIndex() };
+	int targetSquareIndex{ move.GetTargetSquareIndex() };
+
+	uint64_t* movedBitBoard{ GetBitboardFromSquare(targetSquareIndex) };
+
+	switch (move.GetMoveType())
+	{
+		case MoveType::KingCastle:
+		{
+			uint64_t* rookBitBoard{ GetBitboardFromSquare(targetSquareIndex - 1) };
+			*rookBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex - 1] | m_BitMasks.bitMasks[targetSquareIndex + 1];
+
+			*movedBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] | m_BitMasks.bitMasks[startSquareIndex];
+			break;
+		}
+		case MoveType::QueenCastle:
+		{
+			uint64_t* rookBitBoard{ GetBitboardFromSquare(targetSquareIndex + 1) };
+			*rookBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex + 1] | m_BitMasks.bitMasks[targetSquareIndex - 2];
+
+			*movedBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] | m_BitMasks.bitMasks[startSquareIndex];
+			break;
+		}
+		case MoveType::KnightPromotion:
+		case MoveType::BishopPromotion:
+		case MoveType::RookPromotion:
+		case MoveType::QueenPromotion:
+		case MoveType::KnightPromotionCapture:
+		case MoveType::BishopPromotionCapture:
+		case MoveType::RookPromotionCapture:
+		case MoveType::QueenPromotionCapture:
+		{
+			*movedBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex];
+			(m_WhiteToMove ? m_BitBoards.whitePawns : m_BitBoards.blackPawns) |= m_BitMasks.bitMasks[startSquareIndex];
+			break;
+		}
+		default:
+		{
+			*movedBitBoard ^= m_BitMasks.bitMasks[targetSquareIndex] | m_BitMasks.bitMasks[startSquareIndex];
+			break;
+		}
+	}
+
+	if (capturedPieceIndex >= 0)
+	{
+		m_BitBoards.GetPieceBitBoard(capturedPieceIndex) |= m_BitMasks.bitMasks[GetCapturedSquareIndex(move)];
+	}
+
+	UpdateColorBitboards();
 }
 
 void ChessBoard::UpdateThreatMap(Move move, bool useMove)
@@ -335,76 +484,154 @@ void ChessBoard::UpdateThreatMap(Move move, bool useMove)
 	m_CurrentOwnPiecesBitBoard = !m_WhiteToMove ? m_BitBoards.whitePieces : m_BitBoards.blackPieces;
 	m_CurrentOpponentPiecesBitBoard = !m_WhiteToMove ? m_BitBoards.blackPieces : m_BitBoards.whitePieces;
 
-	m_CurrentOwnThreatMap = !m_WhiteToMove ? m_BitBoards.whiteThreatMap : m_BitBoards.blackThreatMap;
 	m_CurrentOpponentThreatMap = !m_WhiteToMove ? m_BitBoards.blackThreatMap : m_BitBoards.whiteThreatMap;
-	
-	uint64_t tempMovedThreatMap1{};
-	uint64_t mask1{ m_BitMasks.bitMasks[move.targetSquareIndex] };
-	int checkCount{};
-
-	if (m_CurrentPawnsBitBoard & mask1)
-		CalculatePawnThreats(move.targetSquareIndex, &tempMovedThreatMap1);
-	else if (m_CurrentKnightsBitBoard & mask1)
-		CalculateKnightThreats(move.targetSquareIndex, &tempMovedThreatMap1);
-	else if (m_CurrentBishopsBitBoard & mask1)
-		CalculateSlidingThreats(move.targetSquareIndex, &tempMovedThreatMap1, 4, 8);
-	else if (m_CurrentRooksBitBoard & mask1)
-		CalculateSlidingThreats(move.targetSquareIndex, &tempMovedThreatMap1,0, 4);
-	else if (m_CurrentQueensBitBoard & mask1)
-		CalculateSlidingThreats(move.targetSquareIndex, &tempMovedThreatMap1, 0, 8);
-	else if (m_CurrentKingBitBoard & mask1)
-		CalculateKingThreats(move.targetSquareIndex, &tempMovedThreatMap1);
-	
-	m_CurrentOwnThreatMap |= tempMovedThreatMap1;
-	if ((m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing) & tempMovedThreatMap1)
+
+	// The threat map only gathers the square attacks
+	BringSquareAttacksUpToDate();
+	m_CurrentOwnThreatMap = 0;
+	for (int squareIndex : BitUtilities::GetSetBits(m_CurrentOwnPiecesBitBoard))
 	{
-		++checkCount;
-		UpdateRayMap(tempMovedThreatMap1, move.targetSquareIndex);
+		m_CurrentOwnThreatMap |= m_SquareAttacks[squareIndex];
 	}
+	assert(m_CurrentOwnThreatMap == CalculateThreatMap());
 
+	// One attackers-to query on the king finds every checking piece
+	uint64_t kingBitBoard{ m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing };
+	uint64_t checkers{ kingBitBoard ? GetAttackersTo(BitUtilities::GetLsb(kingBitBoard), m_BitBoards.whitePieces | m_BitBoards.blackPieces) & m_CurrentOwnPiecesBitBoard : 0 };
+	int checkCount{ BitUtilities::PopCount(checkers) };
 
-	for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+	if (checkCount == 0) { m_IsKingInCheck = false; m_IsKingInDoubleCheck = false; }
+	if (checkCount >= 1) m_IsKingInCheck = true;
+	if (checkCount == 2) m_IsKingInDoubleCheck = true;
+
+	if (checkCount)
 	{
-		if (squareIndex == move.targetSquareIndex) continue;
+		// The piece on the move's target square goes first and the rest by square, the ray of the last checker is kept.
+		// In double check only the king moves, so it only matters for a single checker
+		int targetSquareIndex{ useMove ? move.GetTargetSquareIndex() : 0 };
+		uint64_t otherCheckers{ checkers & ~m_BitMasks.bitMasks[targetSquareIndex] };
+		UpdateRayMap(checkers, otherCheckers ? BitUtilities::GetMsb(otherCheckers) : targetSquareIndex);
+	}
 
-		uint64_t tempMovedThreatMap2{};
+	m_WhiteToMove ? m_BitBoards.whiteThreatMap = m_CurrentOwnThreatMap : m_BitBoards.blackThreatMap = m_CurrentOwnThreatMap;
+	!m_WhiteToMove ? m_BitBoards.whiteThreatMap = m_CurrentOwnThreatMap : m_BitBoards.blackThreatMap = m_CurrentOwnThreatMap;
+}
+uint64_t ChessBoard::CalculateThreatMap()
+{
+	// Sliding threats x-ray through the king in check, so it can't escape by stepping back along the ray
+	uint64_t threatOccupancy{ (m_BitBoards.whitePieces | m_BitBoards.blackPieces) & ~(m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing) };
+
+	uint64_t threatMap{};
+	for (int squareIndex : BitUtilities::GetSetBits(m_CurrentOwnPiecesBitBoard))
+	{
 		uint64_t mask{ m_BitMasks.bitMasks[squareIndex] };
 
 		if (m_CurrentPawnsBitBoard & mask)
-			CalculatePawnThreats(squareIndex, &tempMovedThreatMap2);
+			CalculatePawnThreats(squareIndex, &threatMap);
 		else if (m_CurrentKnightsBitBoard & mask)
-			CalculateKnightThreats(squareIndex, &tempMovedThreatMap2);
+			CalculateKnightThreats(squareIndex, &threatMap);
 		else if (m_CurrentBishopsBitBoard & mask)
-			CalculateSlidingThreats(squareIndex, &tempMovedThreatMap2, 4, 8);
+			threatMap |= MagicBitBoards::GetBishopAttacks(squareIndex, threatOccupancy);
 		else if (m_CurrentRooksBitBoard & mask)
-			CalculateSlidingThreats(squareIndex, &tempMovedThreatMap2, 0, 4);
+			threatMap |= MagicBitBoards::GetRookAttacks(squareIndex, threatOccupancy);
 		else if (m_CurrentQueensBitBoard & mask)
-			CalculateSlidingThreats(squareIndex, &tempMovedThreatMap2, 0, 8);
+			threatMap |= MagicBitBoards::GetQueenAttacks(squareIndex, threatOccupancy);
 		else if (m_CurrentKingBitBoard & mask)
-			CalculateKingThreats(squareIndex, &tempMovedThreatMap2);
+			CalculateKingThreats(squareIndex, &threatMap);
+	}
+	return threatMap;
+}
+uint64_t ChessBoard::UpdateSquareAttacks(uint64_t changedSquares, bool savePreviousAttacks)
+{
+	// Besides the pieces on the changed squares, every slider that reached one of them now sees further or less far
+	uint64_t updatedSquares{ changedSquares };
+	uint64_t slidersBitBoard{ m_BitBoards.whiteBishops | m_BitBoards.whiteRooks | m_BitBoards.whiteQueens |
+							  m_BitBoards.blackBishops | m_BitBoards.blackRooks | m_BitBoards.blackQueens };
+	for (int squareIndex : BitUtilities::GetSetBits(slidersBitBoard & ~changedSquares))
+	{
+		if (m_SquareAttacks[squareIndex] & changedSquares) updatedSquares |= m_BitMasks.bitMasks[squareIndex];
+	}
 
-		if ((m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing) & tempMovedThreatMap2)
-		{
-			++checkCount;
-			UpdateRayMap(tempMovedThreatMap2, squareIndex);
-		}
-		m_CurrentOwnThreatMap |= tempMovedThreatMap2;
+	for (int squareIndex : BitUtilities::GetSetBits(updatedSquares))
+	{
+		if (savePreviousAttacks) m_SquareAttacksHistory.push_back(m_SquareAttacks[squareIndex]);
+		m_SquareAttacks[squareIndex] = CalculateSquareAttacks(squareIndex);
 	}
-	
+	return updatedSquares;
+}
+void ChessBoard::RestoreSquareAttacks(uint64_t savedSquares)
+{
+	assert(BitUtilities::PopCount(savedSquares) <= int(m_SquareAttacksHistory.size()));
 
-	if (checkCount == 0) { m_IsKingInCheck = false; m_IsKingInDoubleCheck = false; }
-	if (checkCount >= 1) m_IsKingInCheck = true;
-	if (checkCount == 2) m_IsKingInDoubleCheck = true;
+	// Pushed from the lowest square up, so they come off from the highest down
+	while (savedSquares)
+	{
+		const int squareIndex{ BitUtilities::GetMsb(savedSquares) };
+		savedSquares ^= m_BitMasks.bitMasks[squareIndex];
 
-	m_WhiteToMove ? m_BitBoards.whiteThreatMap = m_CurrentOwnThreatMap : m_BitBoards.blackThreatMap = m_CurrentOwnThreatMap;
-	!m_WhiteToMove ? m_BitBoards.whiteThreatMap = m_CurrentOwnThreatMap : m_BitBoards.blackThreatMap = m_CurrentOwnThreatMap;
+		m_SquareAttacks[squareIndex] = m_SquareAttacksHistory.back();
+		m_SquareAttacksHistory.pop_back();
+	}
+}
+void ChessBoard::BringSquareAttacksUpToDate()
+{
+	if (m_SquareAttacksZobristKey == m_ZobristKey) return;
+
+	// One move behind only the squares of that move changed, anything further gets worked out from scratch
+	UndoRecord* pLastUndoRecord{ m_UndoHistoryCounter > 0 ? &m_UndoHistory[m_UndoHistoryCounter - 1] : nullptr };
+	if (pLastUndoRecord && pLastUndoRecord->zobristKey == m_SquareAttacksZobristKey)
+	{
+		pLastUndoRecord->savedSquareAttacks = UpdateSquareAttacks(pLastUndoRecord->changedSquares, true);
+		m_SquareAttacksZobristKey = m_ZobristKey;
+	}
+	else RecalculateSquareAttacks();
+
+	// Debug builds check every square against a full recalculation
+	assert(AreSquareAttacksUpToDate());
+}
+void ChessBoard::RecalculateSquareAttacks()
+{
+	std::fill(std::begin(m_SquareAttacks), std::end(m_SquareAttacks), 0);
+	UpdateSquareAttacks(m_BitBoards.whitePieces | m_BitBoards.blackPieces);
+	m_SquareAttacksZobristKey = m_ZobristKey;
+}
+uint64_t ChessBoard::CalculateSquareAttacks(int squareIndex)
+{
+	constexpr uint64_t notFirstColumn{ ~0x0101010101010101ull };
+	constexpr uint64_t notLastColumn{ ~0x8080808080808080ull };
+
+	const uint64_t squareBitBoard{ m_BitMasks.bitMasks[squareIndex] };
+	const bool isWhite{ bool(m_BitBoards.whitePieces & squareBitBoard) };
+	// Like the threat maps, sliders look through the king of the other color
+	const uint64_t occupancy{ (m_BitBoards.whitePieces | m_BitBoards.blackPieces) & ~(isWhite ? m_BitBoards.blackKing : m_BitBoards.whiteKing) };
+
+	switch (GetPieceIndexFromSquare(squareIndex) % 6)
+	{
+		case 0: return isWhite ? ((squareBitBoard & notFirstColumn) >> 9) | ((squareBitBoard & notLastColumn) >> 7)
+							   : ((squareBitBoard & notFirstColumn) << 7) | ((squareBitBoard & notLastColumn) << 9);
+		case 1: return MagicBitBoards::GetKnightAttacks(squareIndex);
+		case 2: return MagicBitBoards::GetBishopAttacks(squareIndex, occupancy);
+		case 3: return MagicBitBoards::GetRookAttacks(squareIndex, occupancy);
+		case 4: return MagicBitBoards::GetQueenAttacks(squareIndex, occupancy);
+		case 5: return MagicBitBoards::GetKingAttacks(squareIndex);
+		// An empty square gives -1 % 6 == -1
+		default: return 0;
+	}
+}
+bool ChessBoard::AreSquareAttacksUpToDate()
+{
+	for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+	{
+		if (m_SquareAttacks[squareIndex] != CalculateSquareAttacks(squareIndex)) return false;
+	}
+	return true;
 }
 void ChessBoard::UpdateRayMap(uint64_t checkingPieceMap, int targetSquare)
 {
 	m_BitBoards.checkRay = 0;
 	uint64_t kingBitBoard{ m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing };
 
-	int kingSquare{ int(std::log2(kingBitBoard) + 0.5) };
+	int kingSquare{ BitUtilities::GetLsb(kingBitBoard) };
 	int kingSquareRow{kingSquare / 8};
 	int kingSquareCol{kingSquare % 8};
 
@@ -417,7 +644,7 @@ void ChessBoard::UpdateRayMap(uint64_t checkingPieceMap, int targetSquare)
 	if (rowDif == 0)
 	{
 		int offset{ colDif < 0 ? 1 : -1 };
-		for (int index{}; index < abs(colDif); ++index)
+		for (int index{}; index < std::abs(colDif); ++index)
 		{
 			m_BitBoards.checkRay |= m_BitMasks.bitMasks[targetSquare + offset * index];
 		}
@@ -425,15 +652,15 @@ void ChessBoard::UpdateRayMap(uint64_t checkingPieceMap, int targetSquare)
 	else if (colDif == 0)
 	{
 		int offset{ rowDif < 0 ? 8 : -8 };
-		for (int index{}; index < abs(rowDif); ++index)
+		for (int index{}; index < std::abs(rowDif); ++index)
 		{
 			m_BitBoards.checkRay |= m_BitMasks.bitMasks[targetSquare + offset * index];
 		}
 	}
-	else if (abs(rowDif) == abs(colDif))
+	else if (std::abs(rowDif) == std::abs(colDif))
 	{
 		int offset{ (rowDif < 0 ? 8 : -8) + (colDif < 0 ? 1 : -1) };
-		for (int index{}; index < abs(rowDif); ++index)
+		for (int index{}; index < std::abs(rowDif); ++index)
 		{
 			m_BitBoards.checkRay |= m_BitMasks.bitMasks[targetSquare + offset * index];
 		}
@@ -447,7 +674,7 @@ void ChessBoard::UpdatePinnedBoards()
 {
 	m_PinnedBoards.clear();
 
-	for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+	for (int squareIndex : BitUtilities::GetSetBits(m_CurrentBishopsBitBoard | m_CurrentRooksBitBoard | m_CurrentQueensBitBoard))
 	{
 		bool shouldUsePinBoard{ false };
 		uint64_t mask{ m_BitMasks.bitMasks[squareIndex] };
@@ -494,6 +721,22 @@ void ChessBoard::CheckCastleRights(uint64_t startSquareBitBoard, int startSquare
 	}
 	
 
+}
+int ChessBoard::GetCastlingRightsMask()
+{
+	return	(m_WhiteCanCastleKingSide ? 1 : 0) |
+			(m_WhiteCanCastleQueenSide ? 2 : 0) |
+			(m_BlackCanCastleKingSide ? 4 : 0) |
+			(m_BlackCanCastleQueenSide ? 8 : 0);
+}
+uint64_t ChessBoard::CalculateZobristKey()
+{
+	uint64_t key{ Zobrist::GetPiecesDifferenceKey(BitBoards{}, m_BitBoards) };
+	if (!m_WhiteToMove) key ^= Zobrist::GetSideToMoveKey();
+	key ^= Zobrist::GetCastlingKey(GetCastlingRightsMask());
+	key ^= Zobrist::GetEnPassantKey(m_EnPassantSquares);
+
+	return key;
 }
 void ChessBoard::UpdateColorBitboards()
 {
@@ -518,11 +761,41 @@ uint64_t* ChessBoard::GetBitboardFromSquare(int squareIndex)
 
 	return &m_BitBoards.nullBitBoard;
 }
+int ChessBoard::GetPieceIndexFromSquare(int squareIndex)
+{
+	if (squareIndex < 0) return -1;
+
+	for (int pieceIndex{}; pieceIndex < 12; ++pieceIndex)
+	{
+		if (m_BitBoards.GetPieceBitBoard(pieceIndex) & m_BitMasks.bitMasks[squareIndex]) return pieceIndex;
+	}
+	return -1;
+}
+int ChessBoard::GetCapturedSquareIndex(Move move)
+{
+	switch (move.GetMoveType())
+	{
+		case MoveType::Capture:
+		case MoveType::KnightPromotionCapture:
+		case MoveType::BishopPromotionCapture:
+		case MoveType::RookPromotionCapture:
+		case MoveType::QueenPromotionCapture:
+			return move.GetTargetSquareIndex();
+
+		case MoveType::EnPassantCaptureLeft:
+			return move.GetStartSquareIndex() - 1;
+		case MoveType::EnPassantCaptureRight:
+			return move.GetStartSquareIndex() + 1;
+
+		default:
+			return -1;
+	}
+}
 
 
 bool ChessBoard::IsLegalMove(Move _move)
 {
-	for (auto& move : m_PossibleMoves)
+	for (auto& move : GetPossibleMoves())
 	{
 		if (move == _move)
 		{
@@ -533,9 +806,9 @@ bool ChessBoard::IsLegalMove(Move _move)
 }
 Move ChessBoard::GetMoveFromSquares(int startSquare, int targetSquare)
 {
-	for (auto& move : m_PossibleMoves)
+	for (auto& move : GetPossibleMoves())
 	{
-		if (move.startSquareIndex == startSquare && move.targetSquareIndex == targetSquare)
+		if (move.GetStartSquareIndex() == startSquare && move.GetTargetSquareIndex() == targetSquare)
 		{
 			return move;
 		}
@@ -543,6 +816,41 @@ Move ChessBoard::GetMoveFromSquares(int startSquare, int targetSquare)
 
 	return Move();
 }
+Move ChessBoard::GetMoveFromString(const std::string& moveString)
+{
+	if (moveString.size() < 4) return Move();
+
+	// Square 0 is a8
+	auto GetSquareIndex{ [](char file, char rank) { return (file < 'a' || file > 'h' || rank < '1' || rank > '8') ? -1 : ('8' - rank) * 8 + (file - 'a'); } };
+	int startSquare{ GetSquareIndex(moveString[0], moveString[1]) };
+	int targetSquare{ GetSquareIndex(moveString[2], moveString[3]) };
+	if (startSquare < 0 || targetSquare < 0) return Move();
+
+	for (Move move : GetPseudoLegalMoves())
+	{
+		if (move.GetStartSquareIndex() != startSquare || move.GetTargetSquareIndex() != targetSquare) continue;
+
+		// Every promotion piece is a separate move with the same squares
+		if (GetMoveString(move) == moveString.substr(0, 5)) return move;
+	}
+
+	return Move();
+}
+std::string ChessBoard::GetMoveString(Move move)
+{
+	auto GetSquareString{ [](int squareIndex) { return std::string{ char('a' + squareIndex % 8), char('8' - squareIndex / 8) }; } };
+	std::string moveString{ GetSquareString(move.GetStartSquareIndex()) + GetSquareString(move.GetTargetSquareIndex()) };
+
+	switch (move.GetMoveType())
+	{
+	case MoveType::KnightPromotion: case MoveType::KnightPromotionCapture: moveString += 'n'; break;
+	case MoveType::BishopPromotion: case MoveType::BishopPromotionCapture: moveString += 'b'; break;
+	case MoveType::RookPromotion:	case MoveType::RookPromotionCapture:   moveString += 'r'; break;
+	case MoveType::QueenPromotion:	case MoveType::QueenPromotionCapture:  moveString += 'q'; break;
+	default: break;
+	}
+	return moveString;
+}
 
 
 void ChessBoard::CalculatePossibleMoves()
@@ -563,30 +871,37 @@ void ChessBoard::CalculatePossibleMoves()
 
 	m_PossibleMoves.clear();
 
-	for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+	// UpdateThreatMap just brought the square attacks up to date. They look through the other king, so a slider that
+	// attacks it (only after an illegal move) gets its attacks looked up again
+	assert(m_SquareAttacksZobristKey == m_ZobristKey);
+	uint64_t occupancy{ m_BitBoards.whitePieces | m_BitBoards.blackPieces };
+	uint64_t opponentKingBitBoard{ m_WhiteToMove ? m_BitBoards.blackKing : m_BitBoards.whiteKing };
+
+	// In double check only the king can move
+	uint64_t movingPieces{ m_IsKingInDoubleCheck ? 0 : m_CurrentPawnsBitBoard | m_CurrentKnightsBitBoard | m_CurrentBishopsBitBoard |
+																			m_CurrentRooksBitBoard | m_CurrentQueensBitBoard };
+	for (int squareIndex : BitUtilities::GetSetBits(movingPieces))
 	{
-		if (!m_IsKingInDoubleCheck)
-		{
-			uint64_t mask{ m_BitMasks.bitMasks[squareIndex] };
-			AdjustCurrentPinBoard(squareIndex);
+		uint64_t mask{ m_BitMasks.bitMasks[squareIndex] };
+		AdjustCurrentPinBoard(squareIndex);
 
-			if (m_CurrentPawnsBitBoard & mask)
-				CalculatePawnMoves(squareIndex);
-			else if (m_CurrentKnightsBitBoard & mask)
-				CalculateKnightMoves(squareIndex);
-			else if (m_CurrentBishopsBitBoard & mask)
-				CalculateSlidingMoves(squareIndex, 4, 8);
-			else if (m_CurrentRooksBitBoard & mask)
-				CalculateSlidingMoves(squareIndex, 0, 4);
-			else if (m_CurrentQueensBitBoard & mask)
-				CalculateSlidingMoves(squareIndex, 0, 8);
-		}
+		if (m_CurrentPawnsBitBoard & mask)
+			CalculatePawnMoves(squareIndex);
+		else if (m_CurrentKnightsBitBoard & mask)
+			CalculateKnightMoves(squareIndex);
+		else if (!(m_SquareAttacks[squareIndex] & opponentKingBitBoard))
+			CalculateSlidingMoves(squareIndex, m_SquareAttacks[squareIndex]);
+		else if (m_CurrentBishopsBitBoard & mask)
+			CalculateSlidingMoves(squareIndex, MagicBitBoards::GetBishopAttacks(squareIndex, occupancy));
+		else if (m_CurrentRooksBitBoard & mask)
+			CalculateSlidingMoves(squareIndex, MagicBitBoards::GetRookAttacks(squareIndex, occupancy));
+		else
+			CalculateSlidingMoves(squareIndex, MagicBitBoards::GetQueenAttacks(squareIndex, occupancy));
 	}
 
-	for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+	for (int squareIndex : BitUtilities::GetSetBits(m_CurrentKingBitBoard))
 	{
-		if (m_CurrentKingBitBoard & m_BitMasks.bitMasks[squareIndex])
-			CalculateKingMoves(squareIndex);
+		CalculateKingMoves(squareIndex);
 	}
 	
 
@@ -608,12 +923,7 @@ void ChessBoard::CalculatePawnMoves(int squareIndex)
 			{
 				if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + verticalOffset])))
 				{
-					Move move{};
-					move.startSquareIndex = squareIndex;
-					move.targetSquareIndex = squareIndex + verticalOffset;
-					move.moveType = MoveType::QuietMove;
-
-					m_PossibleMoves.emplace_back(move);
+					m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex + verticalOffset, MoveType::QuietMove });
 				}
 			}
 
@@ -626,12 +936,7 @@ void ChessBoard::CalculatePawnMoves(int squareIndex)
 				{
 					if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + 2 * verticalOffset])))
 					{
-						Move move{};
-						move.startSquareIndex = squareIndex;
-						move.targetSquareIndex = squareIndex + 2 * verticalOffset;
-						move.moveType = MoveType::DoublePawnPush;
-
-						m_PossibleMoves.emplace_back(move);
+						m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex + 2 * verticalOffset, MoveType::DoublePawnPush });
 					}
 				}
 			}
@@ -650,20 +955,18 @@ void ChessBoard::CalculatePawnMoves(int squareIndex)
 			{
 				if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + verticalOffset])))
 				{
-					Move move{};
-					move.startSquareIndex = squareIndex;
-					move.targetSquareIndex = squareIndex + verticalOffset;
+					Move move{ squareIndex, squareIndex + verticalOffset, MoveType::NullMove };
 
-					move.moveType = MoveType::QueenPromotion;
+					move.SetMoveType(MoveType::QueenPromotion);
 					m_PossibleMoves.emplace_back(move);
 
-					move.moveType = MoveType::RookPromotion;
+					move.SetMoveType(MoveType::RookPromotion);
 					m_PossibleMoves.emplace_back(move);
 
-					move.moveType = MoveType::BishopPromotion;
+					move.SetMoveType(MoveType::BishopPromotion);
 					m_PossibleMoves.emplace_back(move);
 
-					move.moveType = MoveType::KnightPromotion;
+					move.SetMoveType(MoveType::KnightPromotion);
 					m_PossibleMoves.emplace_back(move);
 				}
 			}
@@ -682,26 +985,24 @@ void ChessBoard::CalculatePawnMoves(int squareIndex)
 				{
 					if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + verticalOffset - 1])))
 					{
-						Move move{};
-						move.startSquareIndex = squareIndex;
-						move.targetSquareIndex = squareIndex + verticalOffset - 1;
+						Move move{ squareIndex, squareIndex + verticalOffset - 1, MoveType::NullMove };
 						if (m_WhiteToMove ? squareIndex < 16 : squareIndex > 47)
 						{
-							move.moveType = MoveType::QueenPromotionCapture;
+							move.SetMoveType(MoveType::QueenPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 
-							move.moveType = MoveType::RookPromotionCapture;
+							move.SetMoveType(MoveType::RookPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 
-							move.moveType = MoveType::BishopPromotionCapture;
+							move.SetMoveType(MoveType::BishopPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 
-							move.moveType = MoveType::KnightPromotionCapture;
+							move.SetMoveType(MoveType::KnightPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 						}
 						else
 						{
-							move.moveType = MoveType::Capture;
+							move.SetMoveType(MoveType::Capture);
 							m_PossibleMoves.emplace_back(move);
 						}
 					}
@@ -723,26 +1024,24 @@ void ChessBoard::CalculatePawnMoves(int squareIndex)
 				{
 					if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + verticalOffset + 1])))
 					{
-						Move move{};
-						move.startSquareIndex = squareIndex;
-						move.targetSquareIndex = squareIndex + verticalOffset + 1;
+						Move move{ squareIndex, squareIndex + verticalOffset + 1, MoveType::NullMove };
 						if (m_WhiteToMove ? squareIndex < 16 : squareIndex > 47)
 						{
-							move.moveType = MoveType::QueenPromotionCapture;
+							move.SetMoveType(MoveType::QueenPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 
-							move.moveType = MoveType::RookPromotionCapture;
+							move.SetMoveType(MoveType::RookPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 
-							move.moveType = MoveType::BishopPromotionCapture;
+							move.SetMoveType(MoveType::BishopPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 
-							move.moveType = MoveType::KnightPromotionCapture;
+							move.SetMoveType(MoveType::KnightPromotionCapture);
 							m_PossibleMoves.emplace_back(move);
 						}
 						else
 						{
-							move.moveType = MoveType::Capture;
+							move.SetMoveType(MoveType::Capture);
 							m_PossibleMoves.emplace_back(move);
 						}
 					}
@@ -763,12 +1062,7 @@ void ChessBoard::CalculatePawnMoves(int squareIndex)
 			{
 				if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + verticalOffset - 1])))
 				{
-					Move move{};
-					move.startSquareIndex = squareIndex;
-					move.targetSquareIndex = squareIndex + verticalOffset - 1;
-					move.moveType = MoveType::EnPassantCaptureLeft;
-
-					m_PossibleMoves.emplace_back(move);
+					m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex + verticalOffset - 1, MoveType::EnPassantCaptureLeft });
 				}
 			}
 		}
@@ -785,12 +1079,7 @@ void ChessBoard::CalculatePawnMoves(int squareIndex)
 			{
 				if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + verticalOffset + 1])))
 				{
-					Move move{};
-					move.startSquareIndex = squareIndex;
-					move.targetSquareIndex = squareIndex + verticalOffset + 1;
-					move.moveType = MoveType::EnPassantCaptureRight;
-
-					m_PossibleMoves.emplace_back(move);
+					m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex + verticalOffset + 1, MoveType::EnPassantCaptureRight });
 				}
 			}
 		}
@@ -817,75 +1106,26 @@ void ChessBoard::CalculateKnightMoves(int squareIndex)
 				{
 					if (m_CurrentOpponentPiecesBitBoard & m_BitMasks.bitMasks[newSquareIndex])
 					{
-						Move move{};
-						move.startSquareIndex = squareIndex;
-						move.targetSquareIndex = newSquareIndex;
-						move.moveType = MoveType::Capture;
-
-						m_PossibleMoves.emplace_back(move);
+						m_PossibleMoves.emplace_back(Move{ squareIndex, newSquareIndex, MoveType::Capture });
 					}
 					else if (~m_CurrentOwnPiecesBitBoard & m_BitMasks.bitMasks[newSquareIndex])
 					{
-						Move move{};
-						move.startSquareIndex = squareIndex;
-						move.targetSquareIndex = newSquareIndex;
-						move.moveType = MoveType::QuietMove;
-
-						m_PossibleMoves.emplace_back(move);
+						m_PossibleMoves.emplace_back(Move{ squareIndex, newSquareIndex, MoveType::QuietMove });
 					}
 				}
 			}
 		}
 	}
 }
-void ChessBoard::CalculateSlidingMoves(int squareIndex, int startOffsetIndex, int endOffsetIndex)
+void ChessBoard::CalculateSlidingMoves(int squareIndex, uint64_t attackBitBoard)
 {
-	for (int directionIndex{ startOffsetIndex }; directionIndex < endOffsetIndex; ++directionIndex)
-	{
-		for (int multipliedIndex{ 1 }; multipliedIndex <= m_SlidingOffsets.distancesFromEdges[directionIndex][squareIndex]; ++multipliedIndex)
-		{
-			int currentOffset{ m_SlidingOffsets.squareOffsets[directionIndex] };
-			
-			if (m_CurrentOwnPiecesBitBoard & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)] )
-			{
-				break;
-			}
-			else if (m_CurrentOpponentPiecesBitBoard & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)] )
-			{
-				if (m_CurrentPinBoard & m_BitMasks.bitMasks[squareIndex + currentOffset * multipliedIndex])
-				{
-					if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + currentOffset * multipliedIndex])))
-					{
-						Move move{};
-						move.startSquareIndex = squareIndex;
-						move.targetSquareIndex = squareIndex + currentOffset * multipliedIndex;
-						move.moveType = MoveType::Capture;
+	uint64_t targetBitBoard{ attackBitBoard & ~m_CurrentOwnPiecesBitBoard & m_CurrentPinBoard };
+	if (m_IsKingInCheck) targetBitBoard &= m_BitBoards.checkRay;
 
-						m_PossibleMoves.emplace_back(move);
-
-					}
-				}
-				break;
-			}
-			else
-			{
-				if (m_CurrentPinBoard & m_BitMasks.bitMasks[squareIndex + currentOffset * multipliedIndex])
-				{
-					if (!(m_IsKingInCheck && !(m_BitBoards.checkRay & m_BitMasks.bitMasks[squareIndex + currentOffset * multipliedIndex])))
-					{
-						Move move{};
-						move.startSquareIndex = squareIndex;
-						move.targetSquareIndex = squareIndex + currentOffset * multipliedIndex;
-						move.moveType = MoveType::QuietMove;
-
-						m_PossibleMoves.emplace_back(move);
-					}
-				}
-			}
-		}
+	for (int targetSquareIndex : BitUtilities::GetSetBits(targetBitBoard))
+	{
+		m_PossibleMoves.emplace_back(Move{ squareIndex, targetSquareIndex, (m_CurrentOpponentPiecesBitBoard & m_BitMasks.bitMasks[targetSquareIndex]) ? MoveType::Capture : MoveType::QuietMove });
 	}
-
-	
 }
 void ChessBoard::CalculateKingMoves(int squareIndex)
 {
@@ -903,23 +1143,13 @@ void ChessBoard::CalculateKingMoves(int squareIndex)
 		
 		else if (m_CurrentOpponentPiecesBitBoard & m_BitMasks.bitMasks[(squareIndex + directionOffset)])
 		{
-			Move move{};
-			move.startSquareIndex = squareIndex;
-			move.targetSquareIndex = squareIndex + directionOffset;
-			move.moveType = MoveType::Capture;
-
-			m_PossibleMoves.emplace_back(move);
+			m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex + directionOffset, MoveType::Capture });
 			
 			continue;
 		}
 		else
 		{
-			Move move{};
-			move.startSquareIndex = squareIndex;
-			move.targetSquareIndex = squareIndex + directionOffset;
-			move.moveType = MoveType::QuietMove;
-
-			m_PossibleMoves.emplace_back(move);
+			m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex + directionOffset, MoveType::QuietMove });
 			
 			continue;
 		}
@@ -940,12 +1170,7 @@ void ChessBoard::CalculateKingMoves(int squareIndex)
 		{
 			if (!IsSquareInCheckByOtherColor(squareIndex + 1) && !IsSquareInCheckByOtherColor(squareIndex + 2))
 			{
-				Move move{};
-				move.startSquareIndex = squareIndex;
-				move.targetSquareIndex = squareIndex + 2;
-				move.moveType = MoveType::KingCastle;
-
-				m_PossibleMoves.emplace_back(move);
+				m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex + 2, MoveType::KingCastle });
 			}
 		}
 	}
@@ -957,17 +1182,156 @@ void ChessBoard::CalculateKingMoves(int squareIndex)
 		{
 			if (!IsSquareInCheckByOtherColor(squareIndex - 1) && !IsSquareInCheckByOtherColor(squareIndex - 2))
 			{
-				Move move{};
-				move.startSquareIndex = squareIndex;
-				move.targetSquareIndex = squareIndex - 2;
-				move.moveType = MoveType::QueenCastle;
-
-				m_PossibleMoves.emplace_back(move);
+				m_PossibleMoves.emplace_back(Move{ squareIndex, squareIndex - 2, MoveType::QueenCastle });
 			}
 		}
 	}	
 }
 
+MoveList ChessBoard::GetPseudoLegalMoves()
+{
+	MoveList moves{};
+	GeneratePseudoLegalMoves(MoveGenerationType::All, moves);
+	return moves;
+}
+void ChessBoard::GeneratePseudoLegalMoves(MoveGenerationType generationType, MoveList& moves)
+{
+	const uint64_t kingBitBoard{ m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing };
+
+	// Square by square with the king last, the same order CalculatePossibleMoves uses
+	uint64_t piecesBitBoard{ (m_WhiteToMove ? m_BitBoards.whitePieces : m_BitBoards.blackPieces) & ~kingBitBoard };
+	for (int squareIndex : BitUtilities::GetSetBits(piecesBitBoard))
+	{
+		CalculatePseudoLegalPieceMoves(squareIndex, generationType, moves);
+	}
+
+	if (kingBitBoard) CalculatePseudoLegalPieceMoves(BitUtilities::GetLsb(kingBitBoard), generationType, moves);
+}
+bool ChessBoard::IsPseudoLegalMove(Move move)
+{
+	if (move.GetMoveType() == MoveType::NullMove) return false;
+
+	int startSquareIndex{ move.GetStartSquareIndex() };
+	if (!((m_WhiteToMove ? m_BitBoards.whitePieces : m_BitBoards.blackPieces) & m_BitMasks.bitMasks[startSquareIndex])) return false;
+
+	// Only the moves of the one piece get generated
+	MoveList pieceMoves{};
+	CalculatePseudoLegalPieceMoves(startSquareIndex, MoveGenerationType::All, pieceMoves);
+
+	return std::find(pieceMoves.begin(), pieceMoves.end(), move) != pieceMoves.end();
+}
+void ChessBoard::CalculatePseudoLegalPieceMoves(int squareIndex, MoveGenerationType generationType, MoveList& moves)
+{
+	const uint64_t occupancy{ m_BitBoards.whitePieces | m_BitBoards.blackPieces };
+	const uint64_t mask{ m_BitMasks.bitMasks[squareIndex] };
+
+	if ((m_WhiteToMove ? m_BitBoards.whitePawns : m_BitBoards.blackPawns) & mask)
+		CalculatePseudoLegalPawnMoves(squareIndex, generationType, moves);
+	else if ((m_WhiteToMove ? m_BitBoards.whiteKnights : m_BitBoards.blackKnights) & mask)
+		AddPseudoLegalMoves(squareIndex, MagicBitBoards::GetKnightAttacks(squareIndex), generationType, moves);
+	else if ((m_WhiteToMove ? m_BitBoards.whiteBishops : m_BitBoards.blackBishops) & mask)
+		AddPseudoLegalMoves(squareIndex, MagicBitBoards::GetBishopAttacks(squareIndex, occupancy), generationType, moves);
+	else if ((m_WhiteToMove ? m_BitBoards.whiteRooks : m_BitBoards.blackRooks) & mask)
+		AddPseudoLegalMoves(squareIndex, MagicBitBoards::GetRookAttacks(squareIndex, occupancy), generationType, moves);
+	else if ((m_WhiteToMove ? m_BitBoards.whiteQueens : m_BitBoards.blackQueens) & mask)
+		AddPseudoLegalMoves(squareIndex, MagicBitBoards::GetQueenAttacks(squareIndex, occupancy), generationType, moves);
+	else if ((m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing) & mask)
+	{
+		AddPseudoLegalMoves(squareIndex, MagicBitBoards::GetKingAttacks(squareIndex), generationType, moves);
+		if (generationType != MoveGenerationType::Captures) CalculatePseudoLegalCastles(squareIndex, moves);
+	}
+}
+void ChessBoard::CalculatePseudoLegalPawnMoves(int squareIndex, MoveGenerationType generationType, MoveList& moves)
+{
+	const int verticalOffset{ m_WhiteToMove ? -8 : 8 };
+	const uint64_t occupancy{ m_BitBoards.whitePieces | m_BitBoards.blackPieces };
+	const uint64_t opponentPiecesBitBoard{ m_WhiteToMove ? m_BitBoards.blackPieces : m_BitBoards.whitePieces };
+	const bool onPromotionRow{ m_WhiteToMove ? squareIndex < 16 : squareIndex > 47 };
+
+	// Promotions count as captures, they change the material just as much
+	const bool includeCaptures{ generationType != MoveGenerationType::Quiets };
+	const bool includeQuiets{ generationType != MoveGenerationType::Captures };
+
+	auto AddPawnMove{ [&](int targetSquareIndex, bool isCapture)
+		{
+			if (!onPromotionRow)
+			{
+				moves.emplace_back(Move{ squareIndex, targetSquareIndex, isCapture ? MoveType::Capture : MoveType::QuietMove });
+				return;
+			}
+			moves.emplace_back(Move{ squareIndex, targetSquareIndex, isCapture ? MoveType::QueenPromotionCapture : MoveType::QueenPromotion });
+			moves.emplace_back(Move{ squareIndex, targetSquareIndex, isCapture ? MoveType::RookPromotionCapture : MoveType::RookPromotion });
+			moves.emplace_back(Move{ squareIndex, targetSquareIndex, isCapture ? MoveType::BishopPromotionCapture : MoveType::BishopPromotion });
+			moves.emplace_back(Move{ squareIndex, targetSquareIndex, isCapture ? MoveType::KnightPromotionCapture : MoveType::KnightPromotion });
+		} };
+
+	int pushSquareIndex{ squareIndex + verticalOffset };
+	if (!(occupancy & m_BitMasks.bitMasks[pushSquareIndex]))
+	{
+		if (onPromotionRow ? includeCaptures : includeQuiets) AddPawnMove(pushSquareIndex, false);
+
+		bool onDoublePushRow{ m_WhiteToMove ? squareIndex > 47 : squareIndex < 16 };
+		if (includeQuiets && onDoublePushRow && !(occupancy & m_BitMasks.bitMasks[pushSquareIndex + verticalOffset]))
+		{
+			moves.emplace_back(Move{ squareIndex, pushSquareIndex + verticalOffset, MoveType::DoublePawnPush });
+		}
+	}
+
+	if (!includeCaptures) return;
+
+	if (squareIndex % 8 != 0 && (opponentPiecesBitBoard & m_BitMasks.bitMasks[pushSquareIndex - 1])) AddPawnMove(pushSquareIndex - 1, true);
+	if (squareIndex % 8 != 7 && (opponentPiecesBitBoard & m_BitMasks.bitMasks[pushSquareIndex + 1])) AddPawnMove(pushSquareIndex + 1, true);
+
+	if (squareIndex % 8 != 0 && (m_EnPassantSquares & m_BitMasks.bitMasks[pushSquareIndex - 1]))
+	{
+		moves.emplace_back(Move{ squareIndex, pushSquareIndex - 1, MoveType::EnPassantCaptureLeft });
+	}
+	if (squareIndex % 8 != 7 && (m_EnPassantSquares & m_BitMasks.bitMasks[pushSquareIndex + 1]))
+	{
+		moves.emplace_back(Move{ squareIndex, pushSquareIndex + 1, MoveType::EnPassantCaptureRight });
+	}
+}
+void ChessBoard::CalculatePseudoLegalCastles(int kingSquareIndex, MoveList& moves)
+{
+	// Castling gets checked up front, playing it only looks at the square the king ends up on
+	if (m_IsKingInCheck) return;
+
+	const uint64_t occupancy{ m_BitBoards.whitePieces | m_BitBoards.blackPieces };
+
+	// A rook captured on its starting square keeps the castling right, so the rook gets checked as well
+	uint64_t rooksBitBoard{ m_WhiteToMove ? m_BitBoards.whiteRooks : m_BitBoards.blackRooks };
+	bool canCastleKingSide{ (m_WhiteToMove ? m_WhiteCanCastleKingSide : m_BlackCanCastleKingSide) && (rooksBitBoard & m_BitMasks.bitMasks[kingSquareIndex + 3]) };
+	bool canCastleQueenSide{ (m_WhiteToMove ? m_WhiteCanCastleQueenSide : m_BlackCanCastleQueenSide) && (rooksBitBoard & m_BitMasks.bitMasks[kingSquareIndex - 4]) };
+
+	if (canCastleKingSide &&
+		!(occupancy & (m_BitMasks.bitMasks[kingSquareIndex + 1] | m_BitMasks.bitMasks[kingSquareIndex + 2])) &&
+		!IsSquareAttacked(kingSquareIndex + 1, !m_WhiteToMove) && !IsSquareAttacked(kingSquareIndex + 2, !m_WhiteToMove))
+	{
+		moves.emplace_back(Move{ kingSquareIndex, kingSquareIndex + 2, MoveType::KingCastle });
+	}
+	if (canCastleQueenSide &&
+		!(occupancy & (m_BitMasks.bitMasks[kingSquareIndex - 1] | m_BitMasks.bitMasks[kingSquareIndex - 2] | m_BitMasks.bitMasks[kingSquareIndex - 3])) &&
+		!IsSquareAttacked(kingSquareIndex - 1, !m_WhiteToMove) && !IsSquareAttacked(kingSquareIndex - 2, !m_WhiteToMove))
+	{
+		moves.emplace_back(Move{ kingSquareIndex, kingSquareIndex - 2, MoveType::QueenCastle });
+	}
+}
+void ChessBoard::AddPseudoLegalMoves(int squareIndex, uint64_t attackBitBoard, MoveGenerationType generationType, MoveList& moves)
+{
+	const uint64_t opponentPiecesBitBoard{ m_WhiteToMove ? m_BitBoards.blackPieces : m_BitBoards.whitePieces };
+	const uint64_t emptyBitBoard{ ~(m_BitBoards.whitePieces | m_BitBoards.blackPieces) };
+
+	uint64_t targetBitBoard{ attackBitBoard };
+	if (generationType == MoveGenerationType::Captures) targetBitBoard &= opponentPiecesBitBoard;
+	else if (generationType == MoveGenerationType::Quiets) targetBitBoard &= emptyBitBoard;
+	else targetBitBoard &= opponentPiecesBitBoard | emptyBitBoard;
+
+	for (int targetSquareIndex : BitUtilities::GetSetBits(targetBitBoard))
+	{
+		moves.emplace_back(Move{ squareIndex, targetSquareIndex, (opponentPiecesBitBoard & m_BitMasks.bitMasks[targetSquareIndex]) ? MoveType::Capture : MoveType::QuietMove });
+	}
+}
+
 void ChessBoard::CalculatePawnThreats(int squareIndex, uint64_t* threatMap)
 {
 	int verticalOffset{ m_WhiteToMove ? 8 : -8 };
@@ -999,43 +1363,6 @@ void ChessBoard::CalculateKnightThreats(int squareIndex, uint64_t* threatMap)
 		}
 	}
 }
-void ChessBoard::CalculateSlidingThreats(int squareIndex, uint64_t* threatMap, int startingOffsetIndex, int endOffsetIndex)
-{
-
-	for (int directionIndex{ startingOffsetIndex }; directionIndex < endOffsetIndex; ++directionIndex)
-	{
-		for (int multipliedIndex{ 1 }; multipliedIndex <= m_SlidingOffsets.distancesFromEdges[directionIndex][squareIndex]; ++multipliedIndex)
-		{
-			int currentOffset{ m_SlidingOffsets.squareOffsets[directionIndex] };
-
-			*threatMap |= m_BitMasks.bitMasks[squareIndex + currentOffset * multipliedIndex];
-
-			// Own pieces = break
-			if (m_CurrentOwnPiecesBitBoard & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)])
-			{
-				break;
-			}
-			// Enemy king = continue
-			else if ((m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing) & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)])
-			{
-				continue;
-			}
-			// any other Enemy Piece = break
-			else if (m_CurrentOpponentPiecesBitBoard & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)])
-			{
-				break;
-			}
-			// nothing = continue
-			else
-			{
-				continue;
-			}
-		}
-
-
-	}
-
-}
 void ChessBoard::CalculateKingThreats(int squareIndex, uint64_t* threatMap)
 {
 	for (int directionIndex{}; directionIndex < 8; ++directionIndex)
@@ -1050,51 +1377,32 @@ void ChessBoard::CalculateKingThreats(int squareIndex, uint64_t* threatMap)
 bool ChessBoard::CalculateSlidingPins(int squareIndex, uint64_t& pinBoard, int startingOffsetIndex, int endOffsetIndex)
 {
 	uint64_t kingBitBoard{ m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing };
-	int kingSquare{ int(std::log2(kingBitBoard) + 0.5) };
-
-	
+	uint64_t stopBitBoard{ m_CurrentOwnPiecesBitBoard | kingBitBoard };
 
 	for (int directionIndex{ startingOffsetIndex }; directionIndex < endOffsetIndex; ++directionIndex)
 	{
-		int amountOfEnemiesInTheWay{};
+		uint64_t ray{ MagicBitBoards::GetRay(directionIndex, squareIndex) };
+		if (!ray) continue;
 
-		for (int multipliedIndex{ 1 }; multipliedIndex <= m_SlidingOffsets.distancesFromEdges[directionIndex][squareIndex]; ++multipliedIndex)
+		// The pin board collects every square walked over, starting at the sliding piece itself
+		uint64_t blockers{ ray & stopBitBoard };
+		bool isPositiveDirection{ m_SlidingOffsets.squareOffsets[directionIndex] > 0 };
+		if (!blockers)
 		{
-			int currentOffset{ m_SlidingOffsets.squareOffsets[directionIndex] };
-
-			pinBoard |= m_BitMasks.bitMasks[squareIndex + currentOffset * (multipliedIndex - 1)];
-
-			// Own pieces
-			if (m_CurrentOwnPiecesBitBoard & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)])
-			{
-				break;
-			}
-			// Enemy king
-			else if ((m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing) & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)])
-			{
-				if (amountOfEnemiesInTheWay == 1)
-				{
-					return true;
-				}
-				else
-				{
-					return false;
-				}
-			}
-			// any other Enemy Piece
-			else if (m_CurrentOpponentPiecesBitBoard & m_BitMasks.bitMasks[(squareIndex + currentOffset * multipliedIndex)])
-			{
-				++amountOfEnemiesInTheWay;
-				continue;
-			}
-			// nothing
-			else
-			{
-				continue;
-			}
+			int edgeSquare{ isPositiveDirection ? BitUtilities::GetMsb(ray) : BitUtilities::GetLsb(ray) };
+			pinBoard |= m_BitMasks.bitMasks[squareIndex] | (ray & ~m_BitMasks.bitMasks[edgeSquare]);
+			continue;
 		}
 
+		int blockerSquare{ isPositiveDirection ? BitUtilities::GetLsb(blockers) : BitUtilities::GetMsb(blockers) };
+		uint64_t betweenBitBoard{ ray & ~MagicBitBoards::GetRay(directionIndex, blockerSquare) & ~m_BitMasks.bitMasks[blockerSquare] };
+		pinBoard |= m_BitMasks.bitMasks[squareIndex] | betweenBitBoard;
+
+		// Own pieces
+		if (m_CurrentOwnPiecesBitBoard & m_BitMasks.bitMasks[blockerSquare]) continue;
 
+		// Enemy king, pinned if exactly one enemy piece is in the way
+		return BitUtilities::PopCount(betweenBitBoard & m_CurrentOpponentPiecesBitBoard) == 1;
 	}
 	return false;
 }
@@ -1116,28 +1424,146 @@ bool ChessBoard::IsOtherKingInCheck()
 {
 	uint64_t kingBitBoard{m_WhiteToMove ? m_BitBoards.blackKing : m_BitBoards.whiteKing };
 
-	int kingSquareIndex{};
-	for (int index{}; index < 64; ++index)
-	{
-		if (kingBitBoard & m_BitMasks.bitMasks[index] )
-		{
-			kingSquareIndex = index;
-			break;
-		}
-	}
-
-	return IsSquareInCheckByOtherColor(kingSquareIndex);
+	return IsSquareInCheckByOtherColor(kingBitBoard ? BitUtilities::GetLsb(kingBitBoard) : 0);
 }
 
 bool ChessBoard::IsSquareInCheckByOtherColor(int squareIndex)
 {
 	return m_CurrentOpponentThreatMap & m_BitMasks.bitMasks[squareIndex];
 }
+bool ChessBoard::IsSquareAttacked(int squareIndex, bool byWhite)
+{
+	constexpr uint64_t notFirstColumn{ ~0x0101010101010101ull };
+	constexpr uint64_t notLastColumn{ ~0x8080808080808080ull };
+
+	const uint64_t occupancy{ m_BitBoards.whitePieces | m_BitBoards.blackPieces };
+	const uint64_t squareBitBoard{ m_BitMasks.bitMasks[squareIndex] };
+
+	// The pawns that attack the square are the ones a pawn of the other color on the square would attack
+	uint64_t pawnAttackers{ byWhite
+		? (((squareBitBoard & notFirstColumn) << 7) | ((squareBitBoard & notLastColumn) << 9)) & m_BitBoards.whitePawns
+		: (((squareBitBoard & notFirstColumn) >> 9) | ((squareBitBoard & notLastColumn) >> 7)) & m_BitBoards.blackPawns };
+	if (pawnAttackers) return true;
+
+	if (MagicBitBoards::GetKnightAttacks(squareIndex) & (byWhite ? m_BitBoards.whiteKnights : m_BitBoards.blackKnights)) return true;
+	if (MagicBitBoards::GetKingAttacks(squareIndex) & (byWhite ? m_BitBoards.whiteKing : m_BitBoards.blackKing)) return true;
+
+	uint64_t queensBitBoard{ byWhite ? m_BitBoards.whiteQueens : m_BitBoards.blackQueens };
+	if (MagicBitBoards::GetBishopAttacks(squareIndex, occupancy) & ((byWhite ? m_BitBoards.whiteBishops : m_BitBoards.blackBishops) | queensBitBoard)) return true;
+	return MagicBitBoards::GetRookAttacks(squareIndex, occupancy) & ((byWhite ? m_BitBoards.whiteRooks : m_BitBoards.blackRooks) | queensBitBoard);
+}
+
+bool ChessBoard::HasNonPawnMaterial()
+{
+	if (m_WhiteToMove) return m_BitBoards.whiteKnights | m_BitBoards.whiteBishops | m_BitBoards.whiteRooks | m_BitBoards.whiteQueens;
+	return m_BitBoards.blackKnights | m_BitBoards.blackBishops | m_BitBoards.blackRooks | m_BitBoards.blackQueens;
+}
+uint64_t ChessBoard::GetAttackersTo(int squareIndex, uint64_t occupancy)
+{
+	constexpr uint64_t notFirstColumn{ ~0x0101010101010101ull };
+	constexpr uint64_t notLastColumn{ ~0x8080808080808080ull };
+
+	const uint64_t squareBitBoard{ m_BitMasks.bitMasks[squareIndex] };
+
+	uint64_t attackers{};
+	attackers |= (((squareBitBoard & notFirstColumn) << 7) | ((squareBitBoard & notLastColumn) << 9)) & m_BitBoards.whitePawns;
+	attackers |= (((squareBitBoard & notFirstColumn) >> 9) | ((squareBitBoard & notLastColumn) >> 7)) & m_BitBoards.blackPawns;
+
+	attackers |= MagicBitBoards::GetKnightAttacks(squareIndex) & (m_BitBoards.whiteKnights | m_BitBoards.blackKnights);
+	attackers |= MagicBitBoards::GetKingAttacks(squareIndex) & (m_BitBoards.whiteKing | m_BitBoards.blackKing);
+
+	const uint64_t queensBitBoard{ m_BitBoards.whiteQueens | m_BitBoards.blackQueens };
+	attackers |= MagicBitBoards::GetBishopAttacks(squareIndex, occupancy) & (m_BitBoards.whiteBishops | m_BitBoards.blackBishops | queensBitBoard);
+	attackers |= MagicBitBoards::GetRookAttacks(squareIndex, occupancy) & (m_BitBoards.whiteRooks | m_BitBoards.blackRooks | queensBitBoard);
+
+	// Pieces taken out of the occupancy have already made their capture
+	return attackers & occupancy;
+}
+int ChessBoard::GetStaticExchangeEvaluation(Move move)
+{
+	const int startSquareIndex{ move.GetStartSquareIndex() };
+	const int targetSquareIndex{ move.GetTargetSquareIndex() };
+
+	int attackerPieceIndex{ GetPieceIndexFromSquare(startSquareIndex) };
+	if (attackerPieceIndex < 0) return 0;
+
+	// What the piece on the target square is worth to whoever captures it next
+	int targetValue{ s_ExchangeValues[attackerPieceIndex % 6] };
+
+	// gains[depth] is the material balance for the side making the capture at that depth, if the exchange stopped right after it
+	int gains[32]{};
+	int capturedPieceIndex{ GetPieceIndexFromSquare(GetCapturedSquareIndex(move)) };
+	gains[0] = capturedPieceIndex >= 0 ? s_ExchangeValues[capturedPieceIndex % 6] : 0;
+
+	switch (move.GetMoveType())
+	{
+	case MoveType::KnightPromotion: case MoveType::KnightPromotionCapture: targetValue = s_ExchangeValues[1]; break;
+	case MoveType::BishopPromotion: case MoveType::BishopPromotionCapture: targetValue = s_ExchangeValues[2]; break;
+	case MoveType::RookPromotion: case MoveType::RookPromotionCapture: targetValue = s_ExchangeValues[3]; break;
+	case MoveType::QueenPromotion: case MoveType::QueenPromotionCapture: targetValue = s_ExchangeValues[4]; break;
+	default: break;
+	}
+	gains[0] += targetValue - s_ExchangeValues[attackerPieceIndex % 6];
+
+	uint64_t occupancy{ m_BitBoards.whitePieces | m_BitBoards.blackPieces };
+	occupancy &= ~m_BitMasks.bitMasks[startSquareIndex];
+	// The pawn captured en passant isn't on the target square, but it doesn't block anything anymore either
+	if (capturedPieceIndex >= 0) occupancy &= ~m_BitMasks.bitMasks[GetCapturedSquareIndex(move)];
+	occupancy |= m_BitMasks.bitMasks[targetSquareIndex];
+
+	const uint64_t diagonalSliders{ m_BitBoards.whiteBishops | m_BitBoards.blackBishops | m_BitBoards.whiteQueens | m_BitBoards.blackQueens };
+	const uint64_t straightSliders{ m_BitBoards.whiteRooks | m_BitBoards.blackRooks | m_BitBoards.whiteQueens | m_BitBoards.blackQueens };
+
+	uint64_t attackers{ GetAttackersTo(targetSquareIndex, occupancy) };
+	bool whiteToCapture{ !m_WhiteToMove };
+
+	int depth{};
+	while (depth < 31)
+	{
+		uint64_t sideAttackers{ attackers & (whiteToCapture ? m_BitBoards.whitePieces : m_BitBoards.blackPieces) };
+		if (!sideAttackers) break;
+
+		// The least valuable attacker recaptures
+		int pieceType{};
+		uint64_t attackerBitBoard{};
+		for (; pieceType < 6; ++pieceType)
+		{
+			attackerBitBoard = sideAttackers & m_BitBoards.GetPieceBitBoard(pieceType + (whiteToCapture ? 0 : 6));
+			if (attackerBitBoard) break;
+		}
+
+		++depth;
+		gains[depth] = targetValue - gains[depth - 1];
+		targetValue = s_ExchangeValues[pieceType];
+
+		// Taking the attacker out of the occupancy uncovers the sliders behind it
+		occupancy &= ~(attackerBitBoard & (~attackerBitBoard + 1));
+		attackers |= (MagicBitBoards::GetBishopAttacks(targetSquareIndex, occupancy) & diagonalSliders) |
+					 (MagicBitBoards::GetRookAttacks(targetSquareIndex, occupancy) & straightSliders);
+		attackers &= occupancy;
+
+		whiteToCapture = !whiteToCapture;
+	}
+
+	// Every side gets to choose between recapturing and standing pat
+	while (depth > 0)
+	{
+		gains[depth - 1] = -std::max(-gains[depth - 1], gains[depth]);
+		--depth;
+	}
+	return gains[0];
+}
 
 
 void ChessBoard::CheckForGameEnd()
 {
 	CheckForCheckmate();
+	CheckForDraw();
+}
+void ChessBoard::CheckForDraw()
+{
+	if (!m_IsDrawDetectionEnabled) return;
+
 	CheckForFiftyMoveRule();
 	CheckForInsufficientMaterial();
 	CheckForRepetition();
@@ -1165,7 +1591,7 @@ void ChessBoard::CheckForCheckmate()
 }
 void ChessBoard::CheckForFiftyMoveRule()
 {
-	if (m_HalfMoveClock >= 50)
+	if (m_HalfMoveClock >= 100)
 	{
 		m_GameProgress = GameProgress::Draw;
 	}
@@ -1240,19 +1666,21 @@ void ChessBoard::CheckForInsufficientMaterial()
 }
 int ChessBoard::GetAmountOfPiecesFromBitBoard(uint64_t bitBoard)
 {
-	int amount{};
-	for (int index{}; index < 64; ++index)
-	{
-		if (bitBoard & m_BitMasks.bitMasks[index] ) ++amount;
-	}
-	return amount;
+	return BitUtilities::PopCount(bitBoard);
 }
 void ChessBoard::CheckForRepetition()
 {
+	// Undo record i holds the key of the position before move i, the current position comes right after the last record.
+	// Only positions with the same side to move and after the last pawn move or capture can be equal.
+	int oldestIndex{ std::max(0, m_UndoHistoryCounter - m_HalfMoveClock) };
+
 	int amountOfCurrentApearences{0};
-	for (int index{}; index < m_GameStateHistoryCounter; ++index)
+	for (int index{ m_UndoHistoryCounter - 1 }; index >= oldestIndex; --index)
 	{
-		if (m_GameStateHistory[index].bitBoards == m_BitBoards)
+		// The positions before a null move of the search can't repeat after it
+		if (m_UndoHistory[index].isNullMove) break;
+
+		if ((m_UndoHistoryCounter - index) % 2 == 0 && m_UndoHistory[index].zobristKey == m_ZobristKey)
 		{
 			++amountOfCurrentApearences;
 		}
@@ -1265,28 +1693,30 @@ void ChessBoard::CheckForRepetition()
 
 }
 
-void ChessBoard::UpdateGameStateHistory()
+const GameState& ChessBoard::GetCurrentGameState(bool includePossibleMoves)
 {
-	GameState gameState{};
-
-	gameState.gameProgress = m_GameProgress;
+	if (includePossibleMoves) UpdateStalePossibleMoves();
 
-	gameState.bitBoards = m_BitBoards;
-	gameState.possibleMoves = m_PossibleMoves;
+	m_CurrentGameState.gameProgress = m_GameProgress;
 
-	gameState.whiteToMove = m_WhiteToMove;
+	m_CurrentGameState.bitBoards = m_BitBoards;
+	if (includePossibleMoves) m_CurrentGameState.possibleMoves = m_PossibleMoves;
+	else m_CurrentGameState.possibleMoves.clear();
 
-	gameState.whiteCanCastleKingSide = m_WhiteCanCastleKingSide;
-	gameState.whiteCanCastleQueenSide = m_WhiteCanCastleQueenSide;
-	gameState.blackCanCastleKingSide = m_BlackCanCastleKingSide;
-	gameState.blackCanCastleQueenSide = m_BlackCanCastleQueenSide;
+	m_CurrentGameState.whiteToMove = m_WhiteToMove;
 
-	gameState.enPassantSquares = m_EnPassantSquares;
-	gameState.halfMoveClock = m_HalfMoveClock;
-	gameState.fullMoveCounter = m_FullMoveCounter;
+	m_CurrentGameState.whiteCanCastleKingSide = m_WhiteCanCastleKingSide;
+	m_CurrentGameState.whiteCanCastleQueenSide = m_WhiteCanCastleQueenSide;
+	m_CurrentGameState.blackCanCastleKingSide = m_BlackCanCastleKingSide;
+	m_CurrentGameState.blackCanCastleQueenSide = m_BlackCanCastleQueenSide;
 
+	m_CurrentGameState.enPassantSquares = m_EnPassantSquares;
+	m_CurrentGameState.zobristKey = m_ZobristKey;
+	m_CurrentGameState.pieceSquareScore = m_PieceSquareScore;
+	m_CurrentGameState.halfMoveClock = m_HalfMoveClock;
+	m_CurrentGameState.fullMoveCounter = m_FullMoveCounter;
 
-	m_GameStateHistory[++m_GameStateHistoryCounter] = gameState;
+	return m_CurrentGameState;
 }
 
 
@@ -3,8 +3,8 @@
 #include <iostream>
 #include <vector>
 #include <memory>
-#include <list>
 #include <stack>
+#include <string>
 #include "HelperStructs.h"
 #include "ChessStructs.h"
 
@@ -12,6 +12,7 @@ class ChessBoard
 {
 public:
 	ChessBoard();
+	ChessBoard(const std::string& FEN);
 
 	~ChessBoard() = default;
 	ChessBoard(const ChessBoard& other) = default;
@@ -21,47 +22,76 @@ public:
 
 
 	
-	int StartMoveGenerationTest(int depth);
-
-	
 	void MakeMove(Move move);
 	void UnMakeLastMove(int customDepth = 1);
 	bool IsLegalMove(Move move);
 	Move GetMoveFromSquares(int startSquare, int targetSquare);
+	// Long algebraic notation as used by UCI, e.g. "e2e4" or "e7e8q". Matched against GetPseudoLegalMoves, so play it with
+	// MakePseudoLegalMove. Returns a NullMove when it isn't a pseudo-legal move
+	Move GetMoveFromString(const std::string& moveString);
+	static std::string GetMoveString(Move move);
 
 	GameProgress GetGameProgress() { return m_GameProgress; }
-
-	std::list<Move> GetPossibleMoves() { return m_PossibleMoves; }
-
-	int GetTotalAmount() { return m_TotalAmount; }
-	int GetCaptureAmount() { return m_CaptureAmount; }
-	int GetEnPassantAmount() { return m_EnPassantAmount; }
-	int GetCastleAmount() { return m_CastleAmount; }
-	int GetPromotionAmount() { return m_PromotionAmount; }
-	int GetCheckAmount() { return m_CheckAmount; }
+	// Perft counts the whole move tree, also past the positions the rules call a draw. Checkmate and stalemate still end the game
+	void SetDrawDetection(bool isEnabled) { m_IsDrawDetectionEnabled = isEnabled; }
+
+	const MoveList& GetPossibleMoves() { UpdateStalePossibleMoves(); return m_PossibleMoves; }
+
+	// Search mode: no pins, check rays or threat maps up front, a move only gets checked for legality when it's played
+	MoveList GetPseudoLegalMoves();
+	// Appends to moves, so a MovePicker can generate one stage at a time
+	void GeneratePseudoLegalMoves(MoveGenerationType generationType, MoveList& moves);
+	// For moves that come from elsewhere, like the transposition table: true when GetPseudoLegalMoves would have it
+	bool IsPseudoLegalMove(Move move);
+	// Plays a move from GetPseudoLegalMoves, one that leaves the own king in check gets taken back and returns false.
+	// Checkmate and stalemate aren't looked for, the caller knows when none of the moves were legal
+	bool MakePseudoLegalMove(Move move);
+	// Passes the turn for null move pruning, undone with UnMakeLastMove. Only for the search, and never while in check
+	void MakeNullMove();
+	bool IsLastMoveNullMove() { return m_UndoHistoryCounter > 0 && m_UndoHistory[m_UndoHistoryCounter - 1].isNullMove; }
+	// Whether the side to move has more than pawns and its king, without that passing can be better than any move
+	bool HasNonPawnMaterial();
+	bool IsSquareAttacked(int squareIndex, bool byWhite);
+	// The pieces of both colors that attack the square. Sliders look through every square left out of the occupancy
+	uint64_t GetAttackersTo(int squareIndex, uint64_t occupancy);
+	// Static exchange evaluation: the material the move wins in pawns when both sides keep recapturing on its target square
+	// with their least valuable piece, each side stopping when that gains it nothing. Works on the bitboards, no moves get made
+	int GetStaticExchangeEvaluation(Move move);
 
 	bool GetWhiteToMove() { return m_WhiteToMove; }
-	GameState GetCurrentGameState() { return m_GameStateHistory[m_GameStateHistoryCounter]; }
+	bool IsKingInCheck() { return m_IsKingInCheck; }
+	// Leaving the possible moves out saves generating them when a position only gets evaluated
+	const GameState& GetCurrentGameState(bool includePossibleMoves = true);
 	int GetFullMoveCounter() { return m_FullMoveCounter; }
+	uint64_t GetZobristKey() { return m_ZobristKey; }
+	// Kept up to date by every move, so evaluating the piece square tables costs nothing extra
+	const PieceSquareScore& GetPieceSquareScore() { return m_PieceSquareScore; }
+	// Piece indices as in BitBoards::GetPieceBitBoard, -1 for an empty square
+	int GetPieceIndexFromSquare(int squareIndex);
+	// The move that led to this position, a NullMove at the start
+	Move GetLastMove() { return GetPreviousMove(0); }
+	// The move pliesAgo moves before the last one, a NullMove when the game doesn't go back that far
+	Move GetPreviousMove(int pliesAgo) { return m_UndoHistoryCounter > pliesAgo ? m_UndoHistory[m_UndoHistoryCounter - 1 - pliesAgo].move : Move{}; }
+	// The key of the position GetPreviousMove(pliesAgo) was played in, 0 when the game doesn't go back that far
+	uint64_t GetPreviousZobristKey(int pliesAgo) { return m_UndoHistoryCounter > pliesAgo ? m_UndoHistory[m_UndoHistoryCounter - 1 - pliesAgo].zobristKey : 0; }
 
 protected:
 
 	BitBoards m_BitBoards{};
-	std::list<Move> m_PossibleMoves{};
+	MoveList m_PossibleMoves{};
 
 private:
 
-	int m_TotalAmount{};
-	int m_CaptureAmount{};
-	int m_EnPassantAmount{};
-	int m_CastleAmount{};
-	int m_PromotionAmount{};
-	int m_CheckAmount{};
+	std::vector<UndoRecord> m_UndoHistory{};
+	int m_UndoHistoryCounter{};
 
-	std::vector<GameState> m_GameStateHistory{};
-	int m_GameStateHistoryCounter{-1};
+	// Only filled in when asked for, MakeMove and UnMakeLastMove never touch it
+	GameState m_CurrentGameState{};
+	// UnMakeLastMove doesn't bring back the move list, it gets generated again the first time it's needed
+	bool m_ArePossibleMovesStale{ false };
 
 	GameProgress m_GameProgress{GameProgress::InProgress};
+	bool m_IsDrawDetectionEnabled{ true };
 
 	bool m_WhiteToMove{ true };
 	bool m_IsKingInCheck{ false };
@@ -75,6 +105,8 @@ private:
 
 
 	uint64_t m_EnPassantSquares{};
+	uint64_t m_ZobristKey{};
+	PieceSquareScore m_PieceSquareScore{};
 
 	int m_HalfMoveClock{};
 	int m_FullMoveCounter{ 1 };
@@ -85,6 +117,9 @@ private:
 
 	const BitMasks m_BitMasks{};
 
+	// Indexed by piece index % 6, the king is worth more than anything it could capture
+	static constexpr int s_ExchangeValues[6]{ 1, 3, 3, 5, 9, 100 };
+
 	uint64_t m_CurrentPawnsBitBoard{};
 	uint64_t m_CurrentKnightsBitBoard{};
 	uint64_t m_CurrentBishopsBitBoard{};
@@ -98,32 +133,58 @@ private:
 	uint64_t m_CurrentOwnThreatMap{};
 	uint64_t m_CurrentOpponentThreatMap{};
 
+	// The attacks of the piece on every square, 0 for an empty one, so a threat map only has to gather them.
+	// They belong to the position with m_SquareAttacksZobristKey: MakeMove brings them up to date from the squares its move
+	// changed and UnMakeLastMove puts the saved ones back, the search's MakePseudoLegalMove leaves them alone
+	uint64_t m_SquareAttacks[64]{};
+	uint64_t m_SquareAttacksZobristKey{};
+	std::vector<uint64_t> m_SquareAttacksHistory{};
+
 	std::vector<uint64_t> m_PinnedBoards{};
 	uint64_t m_CurrentPinBoard{};
 
 
-	int MoveGenerationTest(int depth, int initialDepth);
 
 	void UpdateBitBoards(Move move, uint64_t* startBitBoard);
+	void RestoreBitBoards(Move move, int capturedPieceIndex);
+	// Gathers the threat map of the side that just moved from the square attacks and finds the checking pieces
 	void UpdateThreatMap(Move move, bool useMove = true);
+	// The same threat map worked out from scratch, debug builds check UpdateThreatMap against it
+	uint64_t CalculateThreatMap();
+	// Recalculates the attacks of the pieces on the changed squares and of the sliders whose attacks reached them,
+	// returns the recalculated squares. The previous attacks can be pushed on m_SquareAttacksHistory
+	uint64_t UpdateSquareAttacks(uint64_t changedSquares, bool savePreviousAttacks = false);
+	void RestoreSquareAttacks(uint64_t savedSquares);
+	void BringSquareAttacksUpToDate();
+	void RecalculateSquareAttacks();
+	uint64_t CalculateSquareAttacks(int squareIndex);
+	bool AreSquareAttacksUpToDate();
 	void UpdateRayMap(uint64_t checkingPieceMap, int targetSquare);
 	void UpdatePinnedBoards();
 	void CheckCastleRights(uint64_t startSquareBitBoard, int startSquareIndex);
+	int GetCastlingRightsMask();
+	uint64_t CalculateZobristKey();
 
 	void CalculatePossibleMoves();
 	void CalculatePawnMoves(int squareIndex);
 	void CalculateKnightMoves(int squareIndex);
-	void CalculateSlidingMoves(int squareIndex, int startOffsetIndex, int endOffsetIndex);
+	void CalculateSlidingMoves(int squareIndex, uint64_t attackBitBoard);
 	void CalculateKingMoves(int squareIndex);
 
+	void CalculatePseudoLegalPieceMoves(int squareIndex, MoveGenerationType generationType, MoveList& moves);
+	void CalculatePseudoLegalPawnMoves(int squareIndex, MoveGenerationType generationType, MoveList& moves);
+	void CalculatePseudoLegalCastles(int kingSquareIndex, MoveList& moves);
+	void AddPseudoLegalMoves(int squareIndex, uint64_t attackBitBoard, MoveGenerationType generationType, MoveList& moves);
+
 	void CalculatePawnThreats(int squareIndex, uint64_t* threatMap);
 	void CalculateKnightThreats(int squareIndex, uint64_t* threatMap);
-	void CalculateSlidingThreats(int squareIndex, uint64_t* threatMap, int startingOffsetIndex, int endOffsetIndex);
 	void CalculateKingThreats(int squareIndex, uint64_t* threatMap);
 
 	bool CalculateSlidingPins(int squareIndex, uint64_t& pinBoard, int startingOffsetIndex, int endOffsetIndex);
 	void AdjustCurrentPinBoard(int squareIndex);
 
+	void Initialize(const std::string& FEN);
+
 	void SetBitboardsFromFEN(std::string FEN);
 	void SetPositionFromChar(char c, int& squareIndex);
 	void SetSideToMoveFromChar(char c);
@@ -140,11 +201,19 @@ private:
 
 	void CheckForGameEnd();
 	void CheckForCheckmate();
+	// The fifty move rule, insufficient material and repetitions
+	void CheckForDraw();
 	void CheckForFiftyMoveRule();
 	void CheckForInsufficientMaterial();
 	int GetAmountOfPiecesFromBitBoard(uint64_t bitBoard);
 	void CheckForRepetition();
 
-	void UpdateGameStateHistory();
+	// The part of making a move both modes share: the pieces, castling rights, en passant squares and Zobrist key
+	void PlayMove(Move move);
+	UndoRecord& PushUndoRecord();
+	void UnMakeMove(const UndoRecord& undoRecord);
+	void UpdateStalePossibleMoves();
+
+	int GetCapturedSquareIndex(Move move);
 };
 
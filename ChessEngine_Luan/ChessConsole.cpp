@@ -0,0 +1,507 @@
+// Console driver for the chess core, so perft and the AIs can run without the Win32 front end.
+//
+//	ChessConsole perft <depth> [FEN]
+//	ChessConsole divide <depth> [FEN]
+//	ChessConsole perftsuite <EPD file> [max depth] [cache MB] [legal]
+//	ChessConsole search <AI> [FEN]
+//	ChessConsole selfplay <white AI> <black AI> [max plies] [FEN]
+//	ChessConsole smp <AI> <depth> [max threads] [FEN]
+//	ChessConsole scaling <AI> <seconds> [max threads] [FEN]
+//	ChessConsole playouts <max plies> [seconds]
+//	ChessConsole bench <AI> [depth] [disabled features]
+//
+// AI names: V0, V1, V2, V3, MCST. The FEN may be passed as one quoted argument or as its separate fields.
+// perftsuite walks the pseudo-legal moves the search plays, "legal" checks the legal move generator of the UI and UCI instead,
+// which still gets some of the published counts wrong.
+// Search features, comma separated: NullMovePruning, LateMoveReductions, ReverseFutilityPruning, FutilityPruning, CheckExtension, TreeReuse,
+// CapturesFirstPlayouts.
+
+#include "ChessBoard.h"
+#include "ChessAI_Versions.h"
+#include "Perft.h"
+#include "PlayoutBoard.h"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const std::string g_StartPositionFEN{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" };
+
+	// Fixed positions for comparing search changes: the opening, a quiet middlegame, a tactical one and endgames
+	const std::vector<std::string> g_BenchmarkFENs
+	{
+		g_StartPositionFEN,
+		"r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	float GetSecondsSince(Clock::time_point startTimePoint)
+	{
+		return std::chrono::duration<float>(Clock::now() - startTimePoint).count();
+	}
+	int GetThreadCount()
+	{
+		return std::max(int(std::thread::hardware_concurrency()), 1);
+	}
+
+	std::string GameProgressToString(GameProgress gameProgress)
+	{
+		switch (gameProgress)
+		{
+		case GameProgress::Draw: return "1/2-1/2";
+		case GameProgress::WhiteWon: return "1-0";
+		case GameProgress::BlackWon: return "0-1";
+		default: return "*";
+		}
+	}
+
+	std::string JoinArguments(const std::vector<std::string>& arguments, size_t firstIndex)
+	{
+		if (firstIndex >= arguments.size()) return g_StartPositionFEN;
+
+		std::string joined{ arguments[firstIndex] };
+		for (size_t index{ firstIndex + 1 }; index < arguments.size(); ++index)
+		{
+			joined += ' ' + arguments[index];
+		}
+		return joined;
+	}
+
+	// Leaves value at its default when the optional argument isn't there. False when it isn't a number, so a typo prints the usage instead of aborting
+	template<typename T>
+	bool TryParseArgument(const std::vector<std::string>& arguments, size_t index, T& value)
+	{
+		if (index >= arguments.size()) return true;
+
+		const std::string& argument{ arguments[index] };
+		const char* pEnd{ argument.data() + argument.size() };
+		const auto [pParseEnd, errorCode] { std::from_chars(argument.data(), pEnd, value) };
+		return errorCode == std::errc{} && pParseEnd == pEnd;
+	}
+
+	int PrintUsage()
+	{
+		std::cerr << "Usage:\n"
+				  << "  ChessConsole perft <depth> [FEN]\n"
+				  << "  ChessConsole divide <depth> [FEN]\n"
+				  << "  ChessConsole perftsuite <EPD file> [max depth] [cache MB] [legal]\n"
+				  << "  ChessConsole search <AI> [FEN]\n"
+				  << "  ChessConsole selfplay <white AI> <black AI> [max plies] [FEN]\n"
+				  << "  ChessConsole smp <AI> <depth> [max threads] [FEN]\n"
+				  << "  ChessConsole scaling <AI> <seconds> [max threads] [FEN]\n"
+				  << "  ChessConsole playouts <max plies> [seconds]\n"
+				  << "  ChessConsole bench <AI> [depth] [disabled features]\n"
+				  << "AI names: V0, V1, V2, V3, MCST\n"
+				  << "Search features: NullMovePruning, LateMoveReductions, ReverseFutilityPruning, FutilityPruning, CheckExtension, TreeReuse, CapturesFirstPlayouts\n";
+		return 1;
+	}
+
+	int RunPerft(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 2) return PrintUsage();
+
+		int depth{};
+		if (!TryParseArgument(arguments, 1, depth)) return PrintUsage();
+		ChessBoard chessBoard{ JoinArguments(arguments, 2) };
+
+		Perft perft{ GetThreadCount() };
+
+		Clock::time_point startTimePoint{ Clock::now() };
+		PerftResult result{ perft.Run(chessBoard, depth) };
+		float seconds{ GetSecondsSince(startTimePoint) };
+
+		std::cout << "Depth:      " << depth << '\n'
+				  << "Nodes:      " << result.nodes << '\n'
+				  << "Time (s):   " << seconds << '\n'
+				  << "Nodes/sec:  " << (seconds > 0.f ? uint64_t(result.nodes / seconds) : 0) << '\n';
+		return 0;
+	}
+
+	int RunDivide(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 2) return PrintUsage();
+
+		int depth{};
+		if (!TryParseArgument(arguments, 1, depth)) return PrintUsage();
+		ChessBoard chessBoard{ JoinArguments(arguments, 2) };
+
+		Perft perft{ GetThreadCount() };
+		perft.SetCountDetails(true);
+
+		PerftResult total{};
+		for (const PerftDivideEntry& entry : perft.Divide(chessBoard, depth))
+		{
+			std::cout << ChessBoard::GetMoveString(entry.move) << ": " << entry.result.nodes << '\n';
+			total += entry.result;
+		}
+
+		std::cout << "\nNodes:      " << total.nodes << '\n'
+				  << "Captures:   " << total.captures << '\n'
+				  << "EnPassants: " << total.enPassants << '\n'
+				  << "Castles:    " << total.castles << '\n'
+				  << "Promotions: " << total.promotions << '\n'
+				  << "Checks:     " << total.checks << '\n';
+		return 0;
+	}
+
+	// Every EPD line is a FEN followed by the known node counts, e.g. "<FEN> ;D1 20 ;D2 400"
+	int RunPerftSuite(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 2) return PrintUsage();
+
+		std::ifstream epdFile{ arguments[1] };
+		if (!epdFile) { std::cerr << "Can't open " << arguments[1] << '\n'; return 1; }
+
+		// legal comes last, also when the optional numbers before it are left out
+		std::vector<std::string> numberArguments{ arguments };
+		bool isLegal{ numberArguments.size() > 2 && numberArguments.back() == "legal" };
+		if (isLegal) numberArguments.pop_back();
+		if (numberArguments.size() > 4) return PrintUsage();
+
+		int maxDepth{ 64 };
+		int cacheSizeInMB{};
+		if (!TryParseArgument(numberArguments, 2, maxDepth) || !TryParseArgument(numberArguments, 3, cacheSizeInMB)) return PrintUsage();
+
+		uint64_t totalNodes{};
+		float totalSeconds{};
+		int passedCount{}, failedCount{};
+
+		std::string line{};
+		while (std::getline(epdFile, line))
+		{
+			std::istringstream lineStream{ line };
+			std::string FEN{};
+			std::getline(lineStream, FEN, ';');
+			if (FEN.find('/') == std::string::npos) continue;
+
+			ChessBoard chessBoard{ FEN };
+
+			std::string depthField{};
+			while (std::getline(lineStream, depthField, ';'))
+			{
+				std::istringstream depthStream{ depthField };
+				char depthPrefix{};
+				int depth{};
+				uint64_t expectedNodes{};
+				if (!(depthStream >> depthPrefix >> depth >> expectedNodes) || depthPrefix != 'D' || depth > maxDepth) continue;
+
+				// A new cache every run, so the nodes/sec only measure the move generator
+				Perft perft{ GetThreadCount(), cacheSizeInMB };
+				perft.SetPseudoLegal(!isLegal);
+
+				Clock::time_point startTimePoint{ Clock::now() };
+				uint64_t nodes{ perft.Run(chessBoard, depth).nodes };
+				float seconds{ GetSecondsSince(startTimePoint) };
+
+				totalNodes += nodes;
+				totalSeconds += seconds;
+				(nodes == expectedNodes ? passedCount : failedCount) += 1;
+
+				std::printf("%s D%-2d %12llu %12llu %8.3fs %12llu nps  %s\n", nodes == expectedNodes ? "PASS" : "FAIL", depth,
+							static_cast<unsigned long long>(expectedNodes), static_cast<unsigned long long>(nodes), seconds,
+							static_cast<unsigned long long>(seconds > 0.f ? nodes / seconds : 0), FEN.c_str());
+			}
+		}
+
+		std::printf("\nPassed: %d  Failed: %d  Nodes: %llu  Time: %.3fs  Nodes/sec: %llu\n", passedCount, failedCount,
+					static_cast<unsigned long long>(totalNodes), totalSeconds, static_cast<unsigned long long>(totalSeconds > 0.f ? totalNodes / totalSeconds : 0));
+		return failedCount ? 1 : 0;
+	}
+
+	int RunSearch(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 2) return PrintUsage();
+
+		ChessBoard chessBoard{ JoinArguments(arguments, 2) };
+		std::unique_ptr<ChessAI> pChessAI{ CreateChessAI(arguments[1], &chessBoard, chessBoard.GetWhiteToMove()) };
+		if (!pChessAI) return PrintUsage();
+
+		Clock::time_point startTimePoint{ Clock::now() };
+		Move move{ pChessAI->GetAIMove() };
+		float seconds{ GetSecondsSince(startTimePoint) };
+
+		std::cout << "Best move:  " << ChessBoard::GetMoveString(move) << '\n'
+				  << "Nodes:      " << pChessAI->GetNodeCount() << '\n'
+				  << "QS nodes:   " << pChessAI->GetQuiescenceNodeCount() << '\n'
+				  << "Time (s):   " << seconds << '\n'
+				  << "Nodes/sec:  " << (seconds > 0.f ? uint64_t(pChessAI->GetNodeCount() / seconds) : 0) << '\n'
+				  << "TT hits:    " << pChessAI->GetTranspositionTableHitRate() * 100.f << "%\n"
+				  << "TT fill:    " << pChessAI->GetTranspositionTable().GetFillRate() * 100.f << "%\n"
+				  << "1st cutoff: " << pChessAI->GetFirstMoveCutoffRate() * 100.f << "%\n";
+
+		const MoveList& principalVariation{ pChessAI->GetLastPrincipalVariation() };
+		if (!principalVariation.empty())
+		{
+			std::cout << "PV:        ";
+			for (Move pvMove : principalVariation) std::cout << ' ' << ChessBoard::GetMoveString(pvMove);
+			std::cout << '\n';
+		}
+		return 0;
+	}
+
+	int RunBenchmark(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 2) return PrintUsage();
+
+		// 0 keeps the AI's own depth
+		int depth{};
+		if (!TryParseArgument(arguments, 2, depth)) return PrintUsage();
+
+		// A comma separated list like "NullMovePruning,LateMoveReductions", to measure what each search feature brings
+		SearchFeatures searchFeatures{};
+		if (arguments.size() > 3)
+		{
+			std::istringstream featureStream{ arguments[3] };
+			std::string featureName{};
+			while (std::getline(featureStream, featureName, ','))
+			{
+				if (!searchFeatures.Set(featureName, false)) return PrintUsage();
+			}
+		}
+
+		std::cout << "Nodes        Time (s)   Best move  FEN\n";
+
+		uint64_t totalNodeCount{};
+		float totalSeconds{};
+		for (const std::string& FEN : g_BenchmarkFENs)
+		{
+			ChessBoard chessBoard{ FEN };
+			std::unique_ptr<ChessAI> pChessAI{ CreateChessAI(arguments[1], &chessBoard, chessBoard.GetWhiteToMove()) };
+			if (!pChessAI) return PrintUsage();
+
+			pChessAI->SetSearchLimits(depth, 0.f);
+			pChessAI->SetSearchFeatures(searchFeatures);
+
+			Clock::time_point startTimePoint{ Clock::now() };
+			Move move{ pChessAI->GetAIMove() };
+			float seconds{ GetSecondsSince(startTimePoint) };
+
+			totalNodeCount += pChessAI->GetNodeCount();
+			totalSeconds += seconds;
+			std::printf("%-12llu %-10.3f %-10s %s\n", static_cast<unsigned long long>(pChessAI->GetNodeCount()), seconds,
+						ChessBoard::GetMoveString(move).c_str(), FEN.c_str());
+		}
+
+		std::cout << "Total nodes: " << totalNodeCount << '\n'
+				  << "Time (s):    " << totalSeconds << '\n'
+				  << "Nodes/sec:   " << (totalSeconds > 0.f ? uint64_t(totalNodeCount / totalSeconds) : 0) << '\n';
+		return 0;
+	}
+
+	int RunSelfPlay(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 3) return PrintUsage();
+
+		int maxPlies{ 400 };
+		if (!TryParseArgument(arguments, 3, maxPlies)) return PrintUsage();
+		ChessBoard chessBoard{ JoinArguments(arguments, 4) };
+
+		std::unique_ptr<ChessAI> pWhiteAI{ CreateChessAI(arguments[1], &chessBoard, true) };
+		std::unique_ptr<ChessAI> pBlackAI{ CreateChessAI(arguments[2], &chessBoard, false) };
+		if (!pWhiteAI || !pBlackAI) return PrintUsage();
+
+		Clock::time_point startTimePoint{ Clock::now() };
+		int ply{};
+		for (; ply < maxPlies && chessBoard.GetGameProgress() == GameProgress::InProgress; ++ply)
+		{
+			ChessAI* pChessAI{ chessBoard.GetWhiteToMove() ? pWhiteAI.get() : pBlackAI.get() };
+			Move move{ pChessAI->GetAIMove() };
+			if (move.GetMoveType() == MoveType::NullMove) break;
+
+			if (ply % 2 == 0) std::cout << ply / 2 + 1 << ". ";
+			std::cout << ChessBoard::GetMoveString(move) << (ply % 2 == 0 ? ' ' : '\n') << std::flush;
+
+			chessBoard.MakeMove(move);
+		}
+
+		std::cout << "\nResult:     " << GameProgressToString(chessBoard.GetGameProgress()) << '\n'
+				  << "Plies:      " << ply << '\n'
+				  << "Time (s):   " << GetSecondsSince(startTimePoint) << '\n';
+		return 0;
+	}
+
+	int RunSMPBenchmark(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 3) return PrintUsage();
+
+		int depth{};
+		int maxThreadCount{ 64 };
+		if (!TryParseArgument(arguments, 2, depth) || !TryParseArgument(arguments, 3, maxThreadCount)) return PrintUsage();
+		std::string FEN{ JoinArguments(arguments, 4) };
+
+		std::cout << "Threads  Time (s)   Speedup  Nodes        Nodes/sec    Best move\n";
+
+		float singleThreadSeconds{};
+		for (int threadCount{ 1 }; threadCount <= maxThreadCount; threadCount *= 2)
+		{
+			// A fresh board and AI every run, so no run starts with a table the previous one filled
+			ChessBoard chessBoard{ FEN };
+			std::unique_ptr<ChessAI> pChessAI{ CreateChessAI(arguments[1], &chessBoard, chessBoard.GetWhiteToMove()) };
+			if (!pChessAI) return PrintUsage();
+
+			pChessAI->SetThreadCount(threadCount);
+			pChessAI->SetSearchLimits(depth, 0.f);
+
+			Clock::time_point startTimePoint{ Clock::now() };
+			Move move{ pChessAI->GetAIMove() };
+			float seconds{ GetSecondsSince(startTimePoint) };
+			if (threadCount == 1) singleThreadSeconds = seconds;
+
+			std::printf("%-8d %-10.3f %-8.2f %-12llu %-12llu %s\n", threadCount, seconds, seconds > 0.f ? singleThreadSeconds / seconds : 0.f,
+						static_cast<unsigned long long>(pChessAI->GetNodeCount()),
+						static_cast<unsigned long long>(seconds > 0.f ? pChessAI->GetNodeCount() / seconds : 0),
+						ChessBoard::GetMoveString(move).c_str());
+		}
+		return 0;
+	}
+	// Searches for a fixed time with 1, 2, 4 ... threads up to every core, for searchers like MCST whose work per second is what scales.
+	// Their nodes are iterations
+	int RunScalingBenchmark(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 3) return PrintUsage();
+
+		float seconds{};
+		int maxThreadCount{ GetThreadCount() };
+		if (!TryParseArgument(arguments, 2, seconds) || !TryParseArgument(arguments, 3, maxThreadCount) || maxThreadCount < 1) return PrintUsage();
+		std::string FEN{ JoinArguments(arguments, 4) };
+
+		std::vector<int> threadCounts{};
+		for (int threadCount{ 1 }; threadCount < maxThreadCount; threadCount *= 2) threadCounts.push_back(threadCount);
+		threadCounts.push_back(maxThreadCount);
+
+		std::cout << "Threads  Nodes        Nodes/sec    Speedup  Best move\n";
+
+		float singleThreadNodesPerSecond{};
+		for (int threadCount : threadCounts)
+		{
+			ChessBoard chessBoard{ FEN };
+			std::unique_ptr<ChessAI> pChessAI{ CreateChessAI(arguments[1], &chessBoard, chessBoard.GetWhiteToMove()) };
+			if (!pChessAI) return PrintUsage();
+
+			pChessAI->SetThreadCount(threadCount);
+			pChessAI->SetSearchLimits(0, seconds);
+
+			Clock::time_point startTimePoint{ Clock::now() };
+			Move move{ pChessAI->GetAIMove() };
+			float searchSeconds{ GetSecondsSince(startTimePoint) };
+
+			float nodesPerSecond{ searchSeconds > 0.f ? pChessAI->GetNodeCount() / searchSeconds : 0.f };
+			if (threadCount == 1) singleThreadNodesPerSecond = nodesPerSecond;
+
+			std::printf("%-8d %-12llu %-12llu %-8.2f %s\n", threadCount, static_cast<unsigned long long>(pChessAI->GetNodeCount()),
+						static_cast<unsigned long long>(nodesPerSecond), singleThreadNodesPerSecond > 0.f ? nodesPerSecond / singleThreadNodesPerSecond : 0.f,
+						ChessBoard::GetMoveString(move).c_str());
+		}
+		return 0;
+	}
+
+	// Plays the benchmark positions out with each playout policy: over and over on bare PlayoutBoards,
+	// then as the rollouts of an MCST search that gets the same time for every position
+	int RunPlayoutBenchmark(const std::vector<std::string>& arguments)
+	{
+		if (arguments.size() < 2) return PrintUsage();
+
+		int maxPlies{};
+		float seconds{ 1.f };
+		if (!TryParseArgument(arguments, 1, maxPlies) || !TryParseArgument(arguments, 2, seconds)) return PrintUsage();
+
+		std::vector<GameState> gameStates{};
+		for (const std::string& FEN : g_BenchmarkFENs)
+		{
+			ChessBoard chessBoard{ FEN };
+			gameStates.push_back(chessBoard.GetCurrentGameState(false));
+		}
+
+		auto printRow = [](const std::string& name, uint64_t playoutCount, uint64_t plyCount, float seconds)
+			{
+				std::printf("%-20s %-12llu %-14.2f %-13llu %llu\n", name.c_str(), static_cast<unsigned long long>(playoutCount),
+							playoutCount ? float(plyCount) / playoutCount : 0.f, static_cast<unsigned long long>(playoutCount / seconds),
+							static_cast<unsigned long long>(plyCount / seconds));
+			};
+
+		std::cout << "Policy               Playouts     Plies/playout  Playouts/sec  Plies/sec\n";
+
+		const std::pair<std::string, PlayoutPolicy> playoutPolicies[]{ { "Random", PlayoutPolicy::Random }, { "CapturesFirst", PlayoutPolicy::CapturesFirst } };
+		for (const auto& [policyName, playoutPolicy] : playoutPolicies)
+		{
+			uint64_t randomState{ 0x9E3779B97F4A7C15ull };
+			uint64_t playoutCount{};
+			uint64_t plyCount{};
+
+			Clock::time_point startTimePoint{ Clock::now() };
+			float elapsedSeconds{};
+			do
+			{
+				for (const GameState& gameState : gameStates)
+				{
+					PlayoutBoard playoutBoard{ gameState };
+					plyCount += playoutBoard.Playout(maxPlies, playoutPolicy, randomState);
+				}
+				playoutCount += gameStates.size();
+				elapsedSeconds = GetSecondsSince(startTimePoint);
+			}
+			while (elapsedSeconds < seconds);
+
+			printRow(policyName, playoutCount, plyCount, elapsedSeconds);
+		}
+
+		for (const auto& [policyName, playoutPolicy] : playoutPolicies)
+		{
+			SearchFeatures searchFeatures{};
+			searchFeatures.capturesFirstPlayouts = playoutPolicy == PlayoutPolicy::CapturesFirst;
+
+			uint64_t playoutCount{};
+			uint64_t plyCount{};
+			float totalSeconds{};
+			for (const std::string& FEN : g_BenchmarkFENs)
+			{
+				ChessBoard chessBoard{ FEN };
+				std::unique_ptr<ChessAI> pChessAI{ CreateChessAI("MCST", &chessBoard, chessBoard.GetWhiteToMove()) };
+				pChessAI->SetPlayoutDepth(maxPlies);
+				pChessAI->SetSearchFeatures(searchFeatures);
+				pChessAI->SetSearchLimits(0, seconds / g_BenchmarkFENs.size());
+
+				Clock::time_point startTimePoint{ Clock::now() };
+				pChessAI->GetAIMove();
+				totalSeconds += GetSecondsSince(startTimePoint);
+
+				playoutCount += pChessAI->GetPlayoutCount();
+				plyCount += pChessAI->GetPlayoutPlyCount();
+			}
+
+			printRow("MCST " + policyName, playoutCount, plyCount, totalSeconds);
+		}
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	if (arguments.empty()) return PrintUsage();
+
+	if (arguments[0] == "perft") return RunPerft(arguments);
+	if (arguments[0] == "divide") return RunDivide(arguments);
+	if (arguments[0] == "perftsuite") return RunPerftSuite(arguments);
+	if (arguments[0] == "search") return RunSearch(arguments);
+	if (arguments[0] == "selfplay") return RunSelfPlay(arguments);
+	if (arguments[0] == "smp") return RunSMPBenchmark(arguments);
+	if (arguments[0] == "scaling") return RunScalingBenchmark(arguments);
+	if (arguments[0] == "playouts") return RunPlayoutBenchmark(arguments);
+	if (arguments[0] == "bench") return RunBenchmark(arguments);
+
+	return PrintUsage();
+}
@@ -8,6 +8,7 @@
 //-----------------------------------------------------------------
 #include "ChessEngine.h"
 #include <chrono>
+#include <thread>
 
 //-----------------------------------------------------------------
 // ChessEngine methods																				
@@ -52,6 +53,13 @@ void ChessEngine::Initialize(HINSTANCE hInstance)
 	m_pDrawableChessBoard = std::make_unique<DrawableChessBoard>();
 	m_pChessAI_White = std::make_unique<ChessAI_V3_AlphaBeta>(m_pDrawableChessBoard.get(), true);
 	m_pChessAI_Black = std::make_unique<ChessAI_V2_AlphaBeta>(m_pDrawableChessBoard.get(), false);
+
+	// V3 deepens until its time runs out, so endgames don't freeze the window for minutes
+	m_pChessAI_White->SetSearchLimits(0, 5.f);
+
+	// Both search with every core, like the parallel root search they had before
+	m_pChessAI_White->SetThreadCount(int(std::thread::hardware_concurrency()));
+	m_pChessAI_Black->SetThreadCount(int(std::thread::hardware_concurrency()));
 }
 
 void ChessEngine::Start()
@@ -71,14 +79,19 @@ void ChessEngine::Paint(RECT rect)
 
 	m_pDrawableChessBoard->Draw(m_CurrentSelectedSquare, m_InMoveGeneration);
 
-	std::wstring s1{ std::to_wstring(m_pDrawableChessBoard->GetTotalAmount()) };
-	std::wstring s2{ std::to_wstring(m_pDrawableChessBoard->GetCaptureAmount()) };
-	std::wstring s3{ std::to_wstring(m_pDrawableChessBoard->GetEnPassantAmount()) };
-	std::wstring s4{ std::to_wstring(m_pDrawableChessBoard->GetCastleAmount()) };
-	std::wstring s5{ std::to_wstring(m_pDrawableChessBoard->GetPromotionAmount()) };
-	std::wstring s6{ std::to_wstring(m_pDrawableChessBoard->GetCheckAmount()) };
+	std::wstring s1{ std::to_wstring(m_MoveGenerationTestResult.nodes) };
+	std::wstring s2{ std::to_wstring(m_MoveGenerationTestResult.captures) };
+	std::wstring s3{ std::to_wstring(m_MoveGenerationTestResult.enPassants) };
+	std::wstring s4{ std::to_wstring(m_MoveGenerationTestResult.castles) };
+	std::wstring s5{ std::to_wstring(m_MoveGenerationTestResult.promotions) };
+	std::wstring s6{ std::to_wstring(m_MoveGenerationTestResult.checks) };
 	std::wstring s7{ std::to_wstring(abs(m_pChessAI_Black->GetCurrentMoveTimer())) };
+	std::wstring s9{ std::to_wstring(m_MoveGenerationTime) };
+	std::wstring s10{ std::to_wstring(m_MoveGenerationTime > 0.f ? uint64_t(m_MoveGenerationTestResult.nodes / m_MoveGenerationTime) : 0) };
 	//std::wstring s8{ std::to_wstring(abs(m_pChessAI_White->GetCurrentMoveTimer())) };
+	std::wstring s11{ std::to_wstring(m_pChessAI_Black->GetNodeCount()) };
+	std::wstring s12{ std::to_wstring(int(m_pChessAI_Black->GetTranspositionTableHitRate() * 100)) };
+	std::wstring s13{ std::to_wstring(int(m_pChessAI_Black->GetTranspositionTable().GetFillRate() * 100)) };
 
 	GAME_ENGINE->SetFont(m_pFont2.get());
 	GAME_ENGINE->SetColor(RGB(200, 200, 200));
@@ -92,9 +105,14 @@ void ChessEngine::Paint(RECT rect)
 	GAME_ENGINE->DrawString(_T("Castles:"), 30, 250);
 	GAME_ENGINE->DrawString(_T("Promotions:"), 30, 300);
 	GAME_ENGINE->DrawString(_T("Checks:"), 30, 350);
+	GAME_ENGINE->DrawString(_T("Time (s):"), 30, 400);
+	GAME_ENGINE->DrawString(_T("Nodes/sec:"), 30, 450);
 
 	GAME_ENGINE->DrawString(_T("Black Timer:"), 30, 570);
 	//GAME_ENGINE->DrawString(_T("White Timer:"), 30, 620);
+	GAME_ENGINE->DrawString(_T("Black Nodes:"), 30, 620);
+	GAME_ENGINE->DrawString(_T("TT Hits (%):"), 30, 670);
+	GAME_ENGINE->DrawString(_T("TT Fill (%):"), 30, 720);
 
 	GAME_ENGINE->SetFont(m_pFont1.get());
 	GAME_ENGINE->SetColor(RGB(24, 24, 100));
@@ -104,9 +122,14 @@ void ChessEngine::Paint(RECT rect)
 	GAME_ENGINE->DrawString(s4, 200, 240);
 	GAME_ENGINE->DrawString(s5, 200, 290);
 	GAME_ENGINE->DrawString(s6, 200, 340);
+	GAME_ENGINE->DrawString(s9, 200, 390);
+	GAME_ENGINE->DrawString(s10, 200, 440);
 
 	GAME_ENGINE->DrawString(s7, 200, 560);
 	//GAME_ENGINE->DrawString(s8, 200, 610);
+	GAME_ENGINE->DrawString(s11, 200, 610);
+	GAME_ENGINE->DrawString(s12, 200, 660);
+	GAME_ENGINE->DrawString(s13, 200, 710);
 
 }
 
@@ -217,7 +240,9 @@ void ChessEngine::KeyPressed(TCHAR cKey)
 
 			
 			m_InMoveGeneration = true;
-			m_MoveGenerationTestAmount = m_pDrawableChessBoard->StartMoveGenerationTest(5);
+			Perft perft{ int(std::thread::hardware_concurrency()) };
+			perft.SetCountDetails(true);
+			m_MoveGenerationTestResult = perft.Run(*m_pDrawableChessBoard, 5);
 
 			auto now = std::chrono::steady_clock::now();
 			m_MoveGenerationTime = std::chrono::duration_cast<std::chrono::microseconds>(now - lastUpdate).count() / 1000000.0f;
@@ -19,6 +19,7 @@
 #include "DrawableChessBoard.h"
 #include "ChessAI.h"
 #include "ChessAI_Versions.h"
+#include "Perft.h"
 
 //-----------------------------------------------------------------
 // ChessEngine Class																
@@ -70,7 +71,7 @@ private:
 
 	std::unique_ptr<Font> m_pFont1{};
 	std::unique_ptr<Font> m_pFont2{};
-	int m_MoveGenerationTestAmount{};
+	PerftResult m_MoveGenerationTestResult{};
 	bool m_InMoveGeneration{ false };
 
 
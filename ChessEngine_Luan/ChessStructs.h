@@ -1,8 +1,9 @@
 #pragma once
 
 #include "stdint.h"
-#include "GameEngine.h"
-#include <list>
+#include <array>
+#include <algorithm>
+#include <cassert>
 #include <vector>
 
 struct BitBoards
@@ -32,6 +33,17 @@ struct BitBoards
 	uint64_t nullBitBoard{};
 
 
+	// Piece indices: whitePawns ... whiteKing = 0-5, blackPawns ... blackKing = 6-11
+	uint64_t& GetPieceBitBoard(int pieceIndex)
+	{
+		static constexpr uint64_t BitBoards::* pieceBitBoards[12]
+		{
+			&BitBoards::whitePawns, &BitBoards::whiteKnights, &BitBoards::whiteBishops, &BitBoards::whiteRooks, &BitBoards::whiteQueens, &BitBoards::whiteKing,
+			&BitBoards::blackPawns, &BitBoards::blackKnights, &BitBoards::blackBishops, &BitBoards::blackRooks, &BitBoards::blackQueens, &BitBoards::blackKing
+		};
+		return this->*pieceBitBoards[pieceIndex];
+	}
+
 	bool operator==(BitBoards other)
 	{
 		return whitePawns == other.whitePawns &&
@@ -87,18 +99,81 @@ enum class MoveType
 
 };
 
-struct Move
+// Which pseudo-legal moves to generate. Captures includes every promotion, Quiets the rest (castling too)
+enum class MoveGenerationType
 {
-	int startSquareIndex{};
-	int targetSquareIndex{};
+	Captures,
+	Quiets,
+	All
+};
+
+// Packed into 16 bits: bits 0-5 start square, bits 6-11 target square, bits 12-15 MoveType
+class Move
+{
+public:
+	constexpr Move() = default;
+	constexpr Move(int startSquareIndex, int targetSquareIndex, MoveType moveType)
+		: m_Data{ static_cast<uint16_t>(startSquareIndex | (targetSquareIndex << 6) | (static_cast<int>(moveType) << 12)) }
+	{
+	}
+
+	constexpr int GetStartSquareIndex() const { return m_Data & 0x3F; }
+	constexpr int GetTargetSquareIndex() const { return (m_Data >> 6) & 0x3F; }
+	constexpr MoveType GetMoveType() const { return static_cast<MoveType>(m_Data >> 12); }
+	constexpr uint16_t GetData() const { return m_Data; }
+
+	constexpr void SetMoveType(MoveType moveType) { m_Data = static_cast<uint16_t>((m_Data & 0x0FFF) | (static_cast<int>(moveType) << 12)); }
+
+	constexpr bool operator==(const Move& other) const { return m_Data == other.m_Data; }
 
-	MoveType moveType{MoveType::NullMove};
+private:
+	uint16_t m_Data{};
+};
+static_assert(sizeof(Move) == 2);
+
+// Fixed-capacity move buffer, 218 is the most legal moves any reachable chess position has.
+// Lives on the stack (or inside a GameState), so filling and copying it never touches the heap.
+class MoveList
+{
+public:
+	static constexpr int s_Capacity{ 218 };
 
-	bool operator==(Move other)
+	MoveList() = default;
+	~MoveList() = default;
+	MoveList(const MoveList& other) { *this = other; }
+	MoveList& operator=(const MoveList& other)
 	{
-		return (startSquareIndex == other.startSquareIndex && targetSquareIndex == other.targetSquareIndex && moveType == other.moveType);
+		if (this != &other)
+		{
+			m_Size = other.m_Size;
+			std::copy(other.begin(), other.end(), m_Moves.begin());
+		}
+		return *this;
 	}
 
+	void push_back(const Move& move) { assert(m_Size < s_Capacity); m_Moves[m_Size++] = move; }
+	void emplace_back(const Move& move) { push_back(move); }
+	void pop_back() { assert(m_Size > 0); --m_Size; }
+	void clear() { m_Size = 0; }
+
+	int size() const { return m_Size; }
+	bool empty() const { return m_Size == 0; }
+
+	Move& operator[](int index) { return m_Moves[index]; }
+	const Move& operator[](int index) const { return m_Moves[index]; }
+	Move& front() { return m_Moves[0]; }
+	const Move& front() const { return m_Moves[0]; }
+	Move& back() { return m_Moves[m_Size - 1]; }
+	const Move& back() const { return m_Moves[m_Size - 1]; }
+
+	Move* begin() { return m_Moves.data(); }
+	Move* end() { return m_Moves.data() + m_Size; }
+	const Move* begin() const { return m_Moves.data(); }
+	const Move* end() const { return m_Moves.data() + m_Size; }
+
+private:
+	std::array<Move, s_Capacity> m_Moves;
+	int m_Size{};
 };
 
 enum class GameProgress
@@ -109,12 +184,30 @@ enum class GameProgress
 	BlackWon
 };
 
+// Sums of the piece square tables over every piece on the board, white minus black. See PieceSquareTables
+struct PieceSquareScore
+{
+	int midgame;
+	int endgame;
+	// Kings and pawns included, the game phase follows from it
+	int pieceCount;
+
+	PieceSquareScore& operator+=(const PieceSquareScore& other)
+	{
+		midgame += other.midgame;
+		endgame += other.endgame;
+		pieceCount += other.pieceCount;
+		return *this;
+	}
+	bool operator==(const PieceSquareScore& other) const = default;
+};
+
 struct GameState
 {
 	GameProgress gameProgress;
 
 	BitBoards bitBoards;
-	std::list<Move> possibleMoves;
+	MoveList possibleMoves;
 
 	bool whiteToMove;
 
@@ -124,11 +217,37 @@ struct GameState
 	bool blackCanCastleKingSide;
 
 	uint64_t enPassantSquares;
+	uint64_t zobristKey;
+	PieceSquareScore pieceSquareScore;
 
 	int halfMoveClock;
 	int fullMoveCounter;
 };
 
+// What MakeMove can't recompute when the move is taken back, the pieces themselves get moved back by UnMakeLastMove.
+struct UndoRecord
+{
+	uint64_t zobristKey;
+	uint64_t enPassantSquares;
+	uint64_t checkRay;
+	PieceSquareScore pieceSquareScore;
+	// Occupied before or after the move but not both
+	uint64_t changedSquares;
+	// Square attacks that were pushed on the history when the move was brought into them
+	uint64_t savedSquareAttacks;
+
+	int halfMoveClock;
+	GameProgress gameProgress;
+
+	Move move;
+	int8_t capturedPieceIndex;
+	uint8_t castlingRightsMask;
+
+	bool isKingInCheck;
+	bool isKingInDoubleCheck;
+	bool isNullMove;
+};
+
 struct KnightOffsets
 {
 	const std::vector<int> squareOffsets{ -10, -17, -15, -6, +10, +17, +15, +6 };
@@ -171,22 +290,22 @@ struct SlidingOffsets
 
 		for (int squareIndex{}; squareIndex < 64; ++squareIndex)
 		{
-			distancesFromEdges[4][squareIndex] = min(distancesFromEdges[0][squareIndex], distancesFromEdges[1][squareIndex]);
+			distancesFromEdges[4][squareIndex] = (std::min)(distancesFromEdges[0][squareIndex], distancesFromEdges[1][squareIndex]);
 		}
 
 		for (int squareIndex{}; squareIndex < 64; ++squareIndex)
 		{
-			distancesFromEdges[5][squareIndex] = min(distancesFromEdges[2][squareIndex], distancesFromEdges[1][squareIndex]);
+			distancesFromEdges[5][squareIndex] = (std::min)(distancesFromEdges[2][squareIndex], distancesFromEdges[1][squareIndex]);
 		}
 
 		for (int squareIndex{}; squareIndex < 64; ++squareIndex)
 		{
-			distancesFromEdges[6][squareIndex] = min(distancesFromEdges[2][squareIndex], distancesFromEdges[3][squareIndex]);
+			distancesFromEdges[6][squareIndex] = (std::min)(distancesFromEdges[2][squareIndex], distancesFromEdges[3][squareIndex]);
 		}
 
 		for (int squareIndex{}; squareIndex < 64; ++squareIndex)
 		{
-			distancesFromEdges[7][squareIndex] = min(distancesFromEdges[0][squareIndex], distancesFromEdges[3][squareIndex]);
+			distancesFromEdges[7][squareIndex] = (std::min)(distancesFromEdges[0][squareIndex], distancesFromEdges[3][squareIndex]);
 		}
 	}
 
@@ -0,0 +1,341 @@
+// UCI front end for the chess core, so the AIs can play in GUIs and tournament managers.
+// The search runs on its own thread, which keeps "stop", "isready" and "quit" responsive while it thinks.
+//
+// Supported: uci, isready, ucinewgame, setoption, position [startpos | fen <FEN>] [moves ...],
+//			  go [depth <n>] [movetime <ms>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>] [infinite], stop, quit
+// Options:   Hash (MB), Threads, PlayoutDepth (MCST), AI (V0, V1, V2, V3, MCST) and a check box per search feature, like NullMovePruning
+
+#include "ChessBoard.h"
+#include "ChessAI_Versions.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+	const std::string g_StartPositionFEN{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" };
+
+	// False for a missing or non-numeric value, so a bad option gets ignored instead of ending the engine
+	bool TryParseInt(const std::string& text, int& value)
+	{
+		const char* pEnd{ text.data() + text.size() };
+		const auto [pParseEnd, errorCode] { std::from_chars(text.data(), pEnd, value) };
+		return errorCode == std::errc{} && pParseEnd == pEnd;
+	}
+	// Tries the pseudo-legal moves until one doesn't leave the king in check, false when mated, stalemated or the game is over
+	bool HasLegalMove(ChessBoard& chessBoard)
+	{
+		for (Move move : chessBoard.GetPseudoLegalMoves())
+		{
+			if (!chessBoard.MakePseudoLegalMove(move)) continue;
+
+			chessBoard.UnMakeLastMove();
+			return true;
+		}
+		return false;
+	}
+
+	class UCIEngine final
+	{
+	public:
+		UCIEngine() = default;
+		~UCIEngine() { StopSearch(); }
+
+		UCIEngine(const UCIEngine& other) = delete;
+		UCIEngine(UCIEngine&& other) = delete;
+		UCIEngine& operator=(const UCIEngine& other) = delete;
+		UCIEngine& operator=(UCIEngine&& other) noexcept = delete;
+
+
+		void Run();
+
+	private:
+
+		std::unique_ptr<ChessBoard> m_pChessBoard{ std::make_unique<ChessBoard>(g_StartPositionFEN) };
+		// Created on the first search, so setoption doesn't have to rebuild it every time
+		std::unique_ptr<ChessAI> m_pChessAI{};
+		std::string m_AIName{ "V3" };
+		int m_HashSizeInMB{ 16 };
+		int m_ThreadCount{ 1 };
+		int m_PlayoutDepth{};
+		SearchFeatures m_SearchFeatures{};
+
+		std::thread m_SearchThread{};
+		bool m_IsSearchInfinite{};
+		std::chrono::steady_clock::time_point m_SearchStartTimePoint{};
+
+		// "go infinite" may only send its bestmove after "stop"
+		std::mutex m_StopMutex{};
+		std::condition_variable m_StopCondition{};
+		bool m_IsStopRequested{};
+
+		std::mutex m_OutputMutex{};
+
+
+		void HandleUCI();
+		void HandleSetOption(std::istringstream& lineStream);
+		void HandleNewGame();
+		void HandlePosition(std::istringstream& lineStream);
+		void HandleGo(std::istringstream& lineStream);
+
+		void Search();
+		void StopSearch();
+		void WaitForSearch();
+
+		void SendSearchInfo(const SearchInfo& searchInfo);
+		void Send(const std::string& line);
+	};
+
+	void UCIEngine::Run()
+	{
+		std::string line{};
+		while (std::getline(std::cin, line))
+		{
+			std::istringstream lineStream{ line };
+			std::string command{};
+			lineStream >> command;
+
+			if (command == "uci") HandleUCI();
+			else if (command == "isready") Send("readyok");
+			else if (command == "setoption") HandleSetOption(lineStream);
+			else if (command == "ucinewgame") HandleNewGame();
+			else if (command == "position") HandlePosition(lineStream);
+			else if (command == "go") HandleGo(lineStream);
+			else if (command == "stop") StopSearch();
+			else if (command == "quit") { StopSearch(); return; }
+		}
+
+		// Input got closed: let a limited search finish so piped commands still get their bestmove
+		WaitForSearch();
+	}
+
+	void UCIEngine::HandleUCI()
+	{
+		Send("id name ChessEngine_Luan");
+		Send("id author Robbe Hijzen");
+		Send("option name Hash type spin default 16 min 0 max 4096");
+		Send("option name Threads type spin default 1 min 1 max 256");
+		Send("option name PlayoutDepth type spin default 0 min 0 max 256");
+		Send("option name AI type combo default V3 var V0 var V1 var V2 var V3 var MCST");
+		for (const std::string& featureName : SearchFeatures::GetNames())
+		{
+			Send("option name " + featureName + " type check default true");
+		}
+		Send("uciok");
+	}
+	void UCIEngine::HandleSetOption(std::istringstream& lineStream)
+	{
+		// setoption name <name> value <value>
+		std::string token{}, name{}, value{};
+		lineStream >> token >> name >> token >> value;
+
+		WaitForSearch();
+
+		int number{};
+		const bool isNumber{ TryParseInt(value, number) };
+
+		if (name == "Hash")
+		{
+			if (!isNumber) return;
+			m_HashSizeInMB = std::clamp(number, 0, 4096);
+			if (m_pChessAI) m_pChessAI->SetTranspositionTableSize(m_HashSizeInMB);
+		}
+		else if (name == "Threads")
+		{
+			if (!isNumber) return;
+			m_ThreadCount = std::clamp(number, 1, ChessAI::s_MaxThreadCount);
+			if (m_pChessAI) m_pChessAI->SetThreadCount(m_ThreadCount);
+		}
+		else if (name == "PlayoutDepth")
+		{
+			if (!isNumber) return;
+			m_PlayoutDepth = std::clamp(number, 0, 256);
+			if (m_pChessAI) m_pChessAI->SetPlayoutDepth(m_PlayoutDepth);
+		}
+		else if (name == "AI" && CreateChessAI(value, m_pChessBoard.get(), true, 0))
+		{
+			m_AIName = value;
+			m_pChessAI.reset();
+		}
+		else if (m_SearchFeatures.Set(name, value == "true"))
+		{
+			if (m_pChessAI) m_pChessAI->SetSearchFeatures(m_SearchFeatures);
+		}
+	}
+	void UCIEngine::HandleNewGame()
+	{
+		WaitForSearch();
+
+		// A new AI starts with an empty transposition table
+		m_pChessAI.reset();
+		m_pChessBoard = std::make_unique<ChessBoard>(g_StartPositionFEN);
+	}
+	void UCIEngine::HandlePosition(std::istringstream& lineStream)
+	{
+		WaitForSearch();
+
+		std::string token{};
+		lineStream >> token;
+
+		std::string FEN{ g_StartPositionFEN };
+		if (token == "fen")
+		{
+			FEN.clear();
+			while (lineStream >> token && token != "moves")
+			{
+				FEN += (FEN.empty() ? "" : " ") + token;
+			}
+		}
+		else lineStream >> token;
+
+		m_pChessBoard = std::make_unique<ChessBoard>(FEN);
+		if (m_pChessAI) m_pChessAI->SetChessBoard(m_pChessBoard.get());
+
+		if (token != "moves") return;
+		while (lineStream >> token)
+		{
+			// Legality is checked when the move is played, the same way the search plays its moves
+			if (!m_pChessBoard->MakePseudoLegalMove(m_pChessBoard->GetMoveFromString(token)))
+			{
+				Send("info string illegal move " + token + ", ignoring the moves after it");
+				break;
+			}
+		}
+	}
+	void UCIEngine::HandleGo(std::istringstream& lineStream)
+	{
+		WaitForSearch();
+
+		int depth{};
+		float moveTime{}, whiteTime{}, blackTime{}, whiteIncrement{}, blackIncrement{};
+		int movesToGo{};
+		bool isInfinite{};
+
+		std::string token{};
+		while (lineStream >> token)
+		{
+			if (token == "depth") lineStream >> depth;
+			else if (token == "movetime") lineStream >> moveTime;
+			else if (token == "wtime") lineStream >> whiteTime;
+			else if (token == "btime") lineStream >> blackTime;
+			else if (token == "winc") lineStream >> whiteIncrement;
+			else if (token == "binc") lineStream >> blackIncrement;
+			else if (token == "movestogo") lineStream >> movesToGo;
+			else if (token == "infinite") isInfinite = true;
+		}
+
+		float remainingTime{ m_pChessBoard->GetWhiteToMove() ? whiteTime : blackTime };
+		float increment{ m_pChessBoard->GetWhiteToMove() ? whiteIncrement : blackIncrement };
+
+		// A bare go has nothing that ends it, so like go infinite it searches until stop
+		if (!depth && !moveTime && !remainingTime) isInfinite = true;
+
+
+		if (!m_pChessAI)
+		{
+			m_pChessAI = CreateChessAI(m_AIName, m_pChessBoard.get(), m_pChessBoard->GetWhiteToMove(), m_HashSizeInMB);
+			m_pChessAI->SetSearchInfoCallback([this](const SearchInfo& searchInfo) { SendSearchInfo(searchInfo); });
+			m_pChessAI->SetThreadCount(m_ThreadCount);
+			m_pChessAI->SetPlayoutDepth(m_PlayoutDepth);
+			m_pChessAI->SetSearchFeatures(m_SearchFeatures);
+		}
+		m_pChessAI->SetControllingWhite(m_pChessBoard->GetWhiteToMove());
+		// UCI times are in milliseconds, the AI works in seconds
+		m_pChessAI->SetSearchLimits(depth, isInfinite ? 0.f : moveTime / 1000.f, isInfinite);
+		if (!isInfinite && !moveTime && remainingTime) m_pChessAI->SetSearchClock(remainingTime / 1000.f, increment / 1000.f, movesToGo);
+
+		m_IsStopRequested = false;
+		m_IsSearchInfinite = isInfinite;
+		m_SearchStartTimePoint = std::chrono::steady_clock::now();
+		m_SearchThread = std::thread{ &UCIEngine::Search, this };
+	}
+
+	void UCIEngine::Search()
+	{
+		Move move{};
+		if (HasLegalMove(*m_pChessBoard)) move = m_pChessAI->GetAIMove();
+
+		if (m_IsSearchInfinite)
+		{
+			std::unique_lock lock{ m_StopMutex };
+			m_StopCondition.wait(lock, [this]() { return m_IsStopRequested; });
+		}
+
+		float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - m_SearchStartTimePoint).count() };
+		SearchInfo searchInfo{};
+		searchInfo.nodeCount = m_pChessAI->GetNodeCount();
+		searchInfo.seconds = seconds;
+		SendSearchInfo(searchInfo);
+		Send("bestmove " + (move.GetMoveType() == MoveType::NullMove ? std::string{ "0000" } : ChessBoard::GetMoveString(move)));
+	}
+	void UCIEngine::StopSearch()
+	{
+		{
+			std::lock_guard lock{ m_StopMutex };
+			m_IsStopRequested = true;
+		}
+		m_StopCondition.notify_all();
+
+		if (m_pChessAI) m_pChessAI->Stop();
+		if (m_SearchThread.joinable()) m_SearchThread.join();
+	}
+	void UCIEngine::WaitForSearch()
+	{
+		// An infinite search never ends on its own
+		if (m_IsSearchInfinite) StopSearch();
+		else if (m_SearchThread.joinable()) m_SearchThread.join();
+	}
+
+	void UCIEngine::SendSearchInfo(const SearchInfo& searchInfo)
+	{
+		std::ostringstream infoStream{};
+		infoStream << "info";
+
+		// Depth 0 is the summary after the search, the AI itself only reports finished depths
+		if (searchInfo.depth > 0)
+		{
+			infoStream << " depth " << searchInfo.depth;
+			if (searchInfo.mateInMoves) infoStream << " score mate " << searchInfo.mateInMoves;
+			else infoStream << " score cp " << searchInfo.centipawns;
+		}
+
+		infoStream << " nodes " << searchInfo.nodeCount
+				   << " nps " << (searchInfo.seconds > 0.f ? uint64_t(searchInfo.nodeCount / searchInfo.seconds) : 0)
+				   << " time " << int(searchInfo.seconds * 1000.f)
+				   << " hashfull " << int(m_pChessAI->GetTranspositionTable().GetFillRate() * 1000.f);
+
+		if (searchInfo.depth > 0)
+		{
+			// Searchers without a principal variation of their own get one from the transposition table
+			const MoveList principalVariation{ searchInfo.principalVariation.empty()
+				? m_pChessAI->GetPrincipalVariation(searchInfo.bestMove, searchInfo.depth) : searchInfo.principalVariation };
+
+			infoStream << " pv";
+			for (Move move : principalVariation)
+			{
+				infoStream << ' ' << ChessBoard::GetMoveString(move);
+			}
+		}
+
+		Send(infoStream.str());
+	}
+	void UCIEngine::Send(const std::string& line)
+	{
+		std::lock_guard lock{ m_OutputMutex };
+		std::cout << line << std::endl;
+	}
+}
+
+int main()
+{
+	UCIEngine uciEngine{};
+	uciEngine.Run();
+	return 0;
+}
@@ -1,4 +1,5 @@
 #include "DrawableChessBoard.h"
+#include "BitUtilities.h"
 
 DrawableChessBoard::DrawableChessBoard()
 {
@@ -40,46 +41,32 @@ void DrawableChessBoard::DrawPieces()
 }
 void DrawableChessBoard::DrawPieceType(uint64_t bitBoard, Bitmap* bitmapGreen, Bitmap* bitmapBeige)
 {
-	int xPos{m_TopLeftPos.x};
-	int yPos{m_TopLeftPos.y - m_CellSize};
-
-	for (int index{}; index < 64; ++index)
+	for (int index : BitUtilities::GetSetBits(bitBoard))
 	{
-		if (index % 8 == 0)
+		int xPos{ m_TopLeftPos.x + index % 8 * m_CellSize };
+		int yPos{ m_TopLeftPos.y + index / 8 * m_CellSize };
+
+		if ((index % 8 + index / 8) & 1)
 		{
-			xPos = m_TopLeftPos.x;
-			yPos += m_CellSize;
+			GAME_ENGINE->DrawBitmap(bitmapGreen, xPos, yPos);
+
 		}
 		else
 		{
-			xPos += m_CellSize;
-		}
-
-		uint64_t mask{ static_cast<unsigned long long>(1) << index };
-		if (bitBoard & mask)
-		{
-			if ((index % 8 + index / 8) & 1)
-			{
-				GAME_ENGINE->DrawBitmap(bitmapGreen, xPos, yPos);
-
-			}
-			else
-			{
-				GAME_ENGINE->DrawBitmap(bitmapBeige, xPos, yPos);
+			GAME_ENGINE->DrawBitmap(bitmapBeige, xPos, yPos);
 
-			}
 		}
 	}
 }
 
 void DrawableChessBoard::DrawPossibleMoves(int startSquareIndex)
 {
-	for (auto& move : m_PossibleMoves)
+	for (auto& move : GetPossibleMoves())
 	{
-		if (move.startSquareIndex == startSquareIndex)
+		if (move.GetStartSquareIndex() == startSquareIndex)
 		{
-			int x = m_TopLeftPos.x + move.targetSquareIndex % 8 * m_CellSize + m_CellSize / 2 - 15;
-			int y = m_TopLeftPos.y + move.targetSquareIndex / 8 * m_CellSize + m_CellSize / 2 - 15;
+			int x = m_TopLeftPos.x + move.GetTargetSquareIndex() % 8 * m_CellSize + m_CellSize / 2 - 15;
+			int y = m_TopLeftPos.y + move.GetTargetSquareIndex() / 8 * m_CellSize + m_CellSize / 2 - 15;
 
 			GAME_ENGINE->FillOval(x, y, 30, 30, 50);
 		}
@@ -0,0 +1,189 @@
+#include "MagicBitBoards.h"
+#include "BitUtilities.h"
+#include <vector>
+
+MagicBitBoards::Magic MagicBitBoards::s_BishopMagics[64]{};
+MagicBitBoards::Magic MagicBitBoards::s_RookMagics[64]{};
+
+uint64_t MagicBitBoards::s_BishopAttackTable[0x1480]{};
+uint64_t MagicBitBoards::s_RookAttackTable[0x19000]{};
+
+uint64_t MagicBitBoards::s_Rays[8][64]{};
+uint64_t MagicBitBoards::s_KnightAttacks[64]{};
+uint64_t MagicBitBoards::s_KingAttacks[64]{};
+
+const bool MagicBitBoards::s_IsInitialized{ MagicBitBoards::Initialize() };
+
+namespace
+{
+	constexpr int g_DirectionOffsets[8]{ -1, -8, +1, +8, -9, -7, +9, +7 };
+	constexpr int g_DirectionColumnSteps[8]{ -1, 0, +1, 0, -1, +1, +1, -1 };
+
+	// xorshift64* with a fixed seed, so the magics found are the same on every run
+	struct MagicRandom
+	{
+		uint64_t state{ 1070372 };
+
+		uint64_t Next()
+		{
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			return state * 2685821657736338717ull;
+		}
+		uint64_t NextSparse() { return Next() & Next() & Next(); }
+	};
+}
+
+bool MagicBitBoards::Initialize()
+{
+	InitializeRays();
+	InitializeLeaperAttacks();
+	InitializeMagics(s_BishopMagics, s_BishopAttackTable, 4, 8);
+	InitializeMagics(s_RookMagics, s_RookAttackTable, 0, 4);
+
+	return true;
+}
+
+void MagicBitBoards::InitializeRays()
+{
+	for (int directionIndex{}; directionIndex < 8; ++directionIndex)
+	{
+		for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+		{
+			uint64_t ray{};
+
+			int currentSquare{ squareIndex };
+			while (true)
+			{
+				int column{ currentSquare % 8 + g_DirectionColumnSteps[directionIndex] };
+				int nextSquare{ currentSquare + g_DirectionOffsets[directionIndex] };
+				if (column < 0 || column > 7 || nextSquare < 0 || nextSquare > 63) break;
+
+				currentSquare = nextSquare;
+				ray |= static_cast<uint64_t>(1) << currentSquare;
+			}
+
+			s_Rays[directionIndex][squareIndex] = ray;
+		}
+	}
+}
+
+void MagicBitBoards::InitializeLeaperAttacks()
+{
+	constexpr int knightRowSteps[8]{ -2, -2, -1, -1, +1, +1, +2, +2 };
+	constexpr int knightColumnSteps[8]{ -1, +1, -2, +2, -2, +2, -1, +1 };
+
+	// Steps that leave the board add nothing
+	auto GetSquareMask{ [](int row, int column) { return (row < 0 || row > 7 || column < 0 || column > 7) ? 0 : static_cast<uint64_t>(1) << (row * 8 + column); } };
+
+	for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+	{
+		int row{ squareIndex / 8 };
+		int column{ squareIndex % 8 };
+
+		for (int index{}; index < 8; ++index)
+		{
+			s_KnightAttacks[squareIndex] |= GetSquareMask(row + knightRowSteps[index], column + knightColumnSteps[index]);
+			s_KingAttacks[squareIndex] |= GetSquareMask(row + (g_DirectionOffsets[index] - g_DirectionColumnSteps[index]) / 8, column + g_DirectionColumnSteps[index]);
+		}
+	}
+}
+
+void MagicBitBoards::InitializeMagics(Magic* magics, uint64_t* attackTable, int startDirectionIndex, int endDirectionIndex)
+{
+	MagicRandom random{};
+
+	std::vector<uint64_t> occupancies(4096);
+	std::vector<uint64_t> references(4096);
+	std::vector<int> epochs(4096);
+	int currentEpoch{};
+
+	uint64_t* currentAttacks{ attackTable };
+	for (int squareIndex{}; squareIndex < 64; ++squareIndex)
+	{
+		Magic& magic{ magics[squareIndex] };
+		magic.mask = CalculateRelevantMask(squareIndex, startDirectionIndex, endDirectionIndex);
+		magic.shift = 64 - BitUtilities::PopCount(magic.mask);
+		magic.attacks = currentAttacks;
+
+		// Carry-Rippler trick to walk over every subset of the mask
+		int size{};
+		uint64_t occupancy{};
+		do
+		{
+			occupancies[size] = occupancy;
+			references[size] = CalculateSlowAttacks(squareIndex, occupancy, startDirectionIndex, endDirectionIndex);
+			++size;
+
+			occupancy = (occupancy - magic.mask) & magic.mask;
+		} while (occupancy);
+
+		bool foundMagic{ false };
+		while (!foundMagic)
+		{
+			do
+			{
+				magic.magic = random.NextSparse();
+			} while (BitUtilities::PopCount((magic.mask * magic.magic) >> 56) < 6);
+
+			++currentEpoch;
+			foundMagic = true;
+			for (int index{}; index < size; ++index)
+			{
+				unsigned int attackIndex{ magic.GetIndex(occupancies[index]) };
+
+				if (epochs[attackIndex] < currentEpoch)
+				{
+					epochs[attackIndex] = currentEpoch;
+					magic.attacks[attackIndex] = references[index];
+				}
+				else if (magic.attacks[attackIndex] != references[index])
+				{
+					foundMagic = false;
+					break;
+				}
+			}
+		}
+
+		currentAttacks += size;
+	}
+}
+
+uint64_t MagicBitBoards::CalculateSlowAttacks(int squareIndex, uint64_t occupancy, int startDirectionIndex, int endDirectionIndex)
+{
+	uint64_t attacks{};
+
+	for (int directionIndex{ startDirectionIndex }; directionIndex < endDirectionIndex; ++directionIndex)
+	{
+		uint64_t ray{ s_Rays[directionIndex][squareIndex] };
+		uint64_t blockers{ ray & occupancy };
+
+		if (blockers)
+		{
+			// Positive offsets walk towards higher square indices, so the closest blocker is the lowest set bit
+			int blockerSquare{ g_DirectionOffsets[directionIndex] > 0 ? BitUtilities::GetLsb(blockers) : BitUtilities::GetMsb(blockers) };
+			ray &= ~s_Rays[directionIndex][blockerSquare];
+		}
+		attacks |= ray;
+	}
+
+	return attacks;
+}
+
+uint64_t MagicBitBoards::CalculateRelevantMask(int squareIndex, int startDirectionIndex, int endDirectionIndex)
+{
+	uint64_t mask{};
+
+	for (int directionIndex{ startDirectionIndex }; directionIndex < endDirectionIndex; ++directionIndex)
+	{
+		uint64_t ray{ s_Rays[directionIndex][squareIndex] };
+		if (!ray) continue;
+
+		// The last square before the edge can never block anything further
+		int edgeSquare{ g_DirectionOffsets[directionIndex] > 0 ? BitUtilities::GetMsb(ray) : BitUtilities::GetLsb(ray) };
+		mask |= ray & ~(static_cast<uint64_t>(1) << edgeSquare);
+	}
+
+	return mask;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "stdint.h"
+
+// Attack lookup: sliding attacks using "fancy" magic bitboards, knight and king attacks from a plain table per square.
+// All tables are static and get built once at program startup, so every ChessBoard (and every copy of one) shares them.
+// Square indices and direction indices follow ChessBoard: square 0 is a8, directions are { -1, -8, +1, +8, -9, -7, +9, +7 }.
+class MagicBitBoards final
+{
+public:
+	MagicBitBoards() = delete;
+
+	static uint64_t GetBishopAttacks(int squareIndex, uint64_t occupancy)
+	{
+		const Magic& magic{ s_BishopMagics[squareIndex] };
+		return magic.attacks[magic.GetIndex(occupancy)];
+	}
+	static uint64_t GetRookAttacks(int squareIndex, uint64_t occupancy)
+	{
+		const Magic& magic{ s_RookMagics[squareIndex] };
+		return magic.attacks[magic.GetIndex(occupancy)];
+	}
+	static uint64_t GetQueenAttacks(int squareIndex, uint64_t occupancy)
+	{
+		return GetBishopAttacks(squareIndex, occupancy) | GetRookAttacks(squareIndex, occupancy);
+	}
+
+	static uint64_t GetKnightAttacks(int squareIndex) { return s_KnightAttacks[squareIndex]; }
+	static uint64_t GetKingAttacks(int squareIndex) { return s_KingAttacks[squareIndex]; }
+
+	// All squares from (excluding) squareIndex up to the edge of the board in the given direction
+	static uint64_t GetRay(int directionIndex, int squareIndex) { return s_Rays[directionIndex][squareIndex]; }
+
+private:
+
+	struct Magic
+	{
+		uint64_t mask{};
+		uint64_t magic{};
+		uint64_t* attacks{};
+		int shift{};
+
+		unsigned int GetIndex(uint64_t occupancy) const { return static_cast<unsigned int>(((occupancy & mask) * magic) >> shift); }
+	};
+
+	static Magic s_BishopMagics[64];
+	static Magic s_RookMagics[64];
+
+	static uint64_t s_BishopAttackTable[0x1480];
+	static uint64_t s_RookAttackTable[0x19000];
+
+	static uint64_t s_Rays[8][64];
+	static uint64_t s_KnightAttacks[64];
+	static uint64_t s_KingAttacks[64];
+
+	static const bool s_IsInitialized;
+
+	static bool Initialize();
+	static void InitializeRays();
+	static void InitializeLeaperAttacks();
+	static void InitializeMagics(Magic* magics, uint64_t* attackTable, int startDirectionIndex, int endDirectionIndex);
+
+	static uint64_t CalculateSlowAttacks(int squareIndex, uint64_t occupancy, int startDirectionIndex, int endDirectionIndex);
+	static uint64_t CalculateRelevantMask(int squareIndex, int startDirectionIndex, int endDirectionIndex);
+};
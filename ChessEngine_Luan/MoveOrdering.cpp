@@ -0,0 +1,113 @@
+#include "MoveOrdering.h"
+#include "MovePicker.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+	// Indexed by piece index % 6: pawn, knight, bishop, rook, queen, king
+	constexpr int g_PieceOrderValues[6]{ 1, 3, 3, 5, 9, 10 };
+}
+
+void MoveOrdering::Clear()
+{
+	m_KillerMoves = {};
+	std::fill_n(&m_History[0][0][0], 2 * 64 * 64, 0);
+	std::fill_n(&m_CounterMoves[0][0], 64 * 64, Move{});
+}
+
+int MoveOrdering::GetCaptureScore(ChessBoard& chessBoard, Move move)
+{
+	int victimValue{};
+	switch (move.GetMoveType())
+	{
+	case MoveType::EnPassantCaptureLeft: case MoveType::EnPassantCaptureRight:
+		victimValue = g_PieceOrderValues[0];
+		break;
+	case MoveType::QueenPromotion: case MoveType::QueenPromotionCapture:
+		victimValue = g_PieceOrderValues[4] - g_PieceOrderValues[0];
+		break;
+	case MoveType::KnightPromotion: case MoveType::KnightPromotionCapture:
+	case MoveType::BishopPromotion: case MoveType::BishopPromotionCapture:
+	case MoveType::RookPromotion: case MoveType::RookPromotionCapture:
+		// Underpromotions hardly ever are the best move, they come after every plain capture
+		victimValue = -g_PieceOrderValues[4];
+		break;
+	default:
+		break;
+	}
+
+	int capturedPieceIndex{ chessBoard.GetPieceIndexFromSquare(move.GetTargetSquareIndex()) };
+	if (capturedPieceIndex >= 0) victimValue += g_PieceOrderValues[capturedPieceIndex % 6];
+
+	int attackerValue{ g_PieceOrderValues[std::max(chessBoard.GetPieceIndexFromSquare(move.GetStartSquareIndex()), 0) % 6] };
+	return victimValue * 16 - attackerValue;
+}
+
+int MoveOrdering::GetMaterialGain(ChessBoard& chessBoard, Move move)
+{
+	int gain{};
+	switch (move.GetMoveType())
+	{
+	case MoveType::EnPassantCaptureLeft: case MoveType::EnPassantCaptureRight:
+		return g_PieceOrderValues[0];
+	case MoveType::QueenPromotion: case MoveType::QueenPromotionCapture:
+		gain = g_PieceOrderValues[4] - g_PieceOrderValues[0];
+		break;
+	case MoveType::RookPromotion: case MoveType::RookPromotionCapture:
+		gain = g_PieceOrderValues[3] - g_PieceOrderValues[0];
+		break;
+	case MoveType::KnightPromotion: case MoveType::KnightPromotionCapture:
+	case MoveType::BishopPromotion: case MoveType::BishopPromotionCapture:
+		gain = g_PieceOrderValues[1] - g_PieceOrderValues[0];
+		break;
+	default:
+		break;
+	}
+
+	int capturedPieceIndex{ chessBoard.GetPieceIndexFromSquare(move.GetTargetSquareIndex()) };
+	if (capturedPieceIndex >= 0) gain += g_PieceOrderValues[capturedPieceIndex % 6];
+	return gain;
+}
+
+std::span<const Move> MoveOrdering::GetKillerMoves(int ply) const
+{
+	if (ply >= s_MaxPly) return {};
+	return m_KillerMoves[ply];
+}
+Move MoveOrdering::GetCounterMove(Move previousMove) const
+{
+	if (previousMove.GetMoveType() == MoveType::NullMove) return Move{};
+	return m_CounterMoves[previousMove.GetStartSquareIndex()][previousMove.GetTargetSquareIndex()];
+}
+
+void MoveOrdering::UpdateCutoff(bool whiteToMove, int ply, int depth, Move previousMove, Move cutoffMove, const MoveList& searchedQuietMoves)
+{
+	// Captures are ordered by what they capture, only the quiet moves learn from cutoffs
+	if (!MovePicker::IsQuietMove(cutoffMove)) return;
+
+	if (ply < s_MaxPly && m_KillerMoves[ply][0] != cutoffMove)
+	{
+		std::move_backward(m_KillerMoves[ply].begin(), m_KillerMoves[ply].end() - 1, m_KillerMoves[ply].end());
+		m_KillerMoves[ply][0] = cutoffMove;
+	}
+
+	if (previousMove.GetMoveType() != MoveType::NullMove)
+	{
+		m_CounterMoves[previousMove.GetStartSquareIndex()][previousMove.GetTargetSquareIndex()] = cutoffMove;
+	}
+
+	// Deeper cutoffs save more work, so they count more
+	int bonus{ std::min(depth * depth, s_MaxHistory / 4) };
+	UpdateHistory(whiteToMove, cutoffMove, bonus);
+	for (Move move : searchedQuietMoves)
+	{
+		UpdateHistory(whiteToMove, move, -bonus);
+	}
+}
+
+void MoveOrdering::UpdateHistory(bool whiteToMove, Move move, int bonus)
+{
+	int& history{ m_History[whiteToMove][move.GetStartSquareIndex()][move.GetTargetSquareIndex()] };
+	history += bonus - history * std::abs(bonus) / s_MaxHistory;
+}
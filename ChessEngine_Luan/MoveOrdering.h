@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ChessBoard.h"
+#include <array>
+#include <span>
+
+// What a search thread learns about good moves while it searches, for the MovePicker to try those first:
+// two killer moves per ply, a butterfly history table and a counter move for every move of the opponent.
+// Every search thread owns one, so none of it needs to be synchronized.
+class MoveOrdering final
+{
+public:
+	static constexpr int s_MaxPly{ 128 };
+	static constexpr int s_KillerMoveCount{ 2 };
+
+	MoveOrdering() = default;
+	~MoveOrdering() = default;
+
+	MoveOrdering(const MoveOrdering& other) = delete;
+	MoveOrdering(MoveOrdering&& other) = delete;
+	MoveOrdering& operator=(const MoveOrdering& other) = delete;
+	MoveOrdering& operator=(MoveOrdering&& other) noexcept = delete;
+
+
+	void Clear();
+
+	// MVV-LVA: the most valuable victim first, and of those the least valuable attacker. A promotion counts as capturing the new piece
+	static int GetCaptureScore(ChessBoard& chessBoard, Move move);
+	// The material a capture or promotion wins in pawns, not counting what it might lose afterwards
+	static int GetMaterialGain(ChessBoard& chessBoard, Move move);
+	int GetQuietScore(bool whiteToMove, Move move) const { return m_History[whiteToMove][move.GetStartSquareIndex()][move.GetTargetSquareIndex()]; }
+
+	std::span<const Move> GetKillerMoves(int ply) const;
+	Move GetCounterMove(Move previousMove) const;
+
+	// For the move that caused a beta cutoff, previousMove being the one that led to the position.
+	// The quiet moves searched before it didn't cut off, so their history goes down
+	void UpdateCutoff(bool whiteToMove, int ply, int depth, Move previousMove, Move cutoffMove, const MoveList& searchedQuietMoves);
+
+private:
+
+	// History scores stay within +-s_MaxHistory, every update moves them a part of the way there
+	static constexpr int s_MaxHistory{ 16384 };
+
+	std::array<std::array<Move, s_KillerMoveCount>, s_MaxPly> m_KillerMoves{};
+	// Indexed by [side to move][start square][target square]
+	int m_History[2][64][64]{};
+	// Indexed by [start square][target square] of the move it answers
+	Move m_CounterMoves[64][64]{};
+
+
+	void UpdateHistory(bool whiteToMove, Move move, int bonus);
+};
@@ -0,0 +1,161 @@
+#include "MovePicker.h"
+#include <algorithm>
+
+MovePicker::MovePicker(ChessBoard& chessBoard, Move hashMove, const MoveOrdering* pMoveOrdering, int ply)
+	: m_ChessBoard{ chessBoard }
+	, m_pMoveOrdering{ pMoveOrdering }
+	, m_HashMove{ hashMove }
+{
+	if (!m_pMoveOrdering) return;
+
+	std::span<const Move> killerMoves{ m_pMoveOrdering->GetKillerMoves(ply) };
+	std::copy(killerMoves.begin(), killerMoves.end(), m_RefutationMoves.begin());
+
+	// A counter move that is also a killer would get handed out twice
+	Move counterMove{ m_pMoveOrdering->GetCounterMove(m_ChessBoard.GetLastMove()) };
+	if (!IsRefutationMove(counterMove)) m_RefutationMoves.back() = counterMove;
+}
+
+MovePicker::MovePicker(ChessBoard& chessBoard, MoveGenerationType generationType)
+	: m_ChessBoard{ chessBoard }
+	, m_pMoveOrdering{ nullptr }
+	, m_HashMove{}
+	, m_GenerationType{ generationType }
+	, m_Stage{ generationType == MoveGenerationType::Quiets ? Stage::GenerateQuiets : Stage::GenerateCaptures }
+{
+}
+
+Move MovePicker::GetNextMove()
+{
+	while (true)
+	{
+		switch (m_Stage)
+		{
+		case Stage::HashMove:
+		{
+			m_Stage = Stage::GenerateCaptures;
+
+			// The transposition table can hand out a move of another position with the same slot, or a key collision
+			if (m_ChessBoard.IsPseudoLegalMove(m_HashMove)) return m_HashMove;
+			m_HashMove = Move{};
+			break;
+		}
+		case Stage::GenerateCaptures:
+		{
+			m_Moves.clear();
+			m_ChessBoard.GeneratePseudoLegalMoves(MoveGenerationType::Captures, m_Moves);
+			ScoreCaptures();
+			m_MoveIndex = 0;
+
+			m_Stage = Stage::Captures;
+			break;
+		}
+		case Stage::Captures:
+		{
+			while (m_MoveIndex < m_Moves.size())
+			{
+				Move move{ PickBestMove() };
+				if (move == m_HashMove) continue;
+
+				if (m_ChessBoard.GetStaticExchangeEvaluation(move) < 0)
+				{
+					m_BadCaptures.push_back(move);
+					continue;
+				}
+				return move;
+			}
+
+			m_MoveIndex = 0;
+			m_Stage = m_GenerationType == MoveGenerationType::Captures ? Stage::Done : Stage::Refutations;
+			break;
+		}
+		case Stage::Refutations:
+		{
+			while (m_MoveIndex < int(m_RefutationMoves.size()))
+			{
+				Move move{ m_RefutationMoves[m_MoveIndex++] };
+
+				// They come from other positions, so they still have to be checked against this one
+				if (move != m_HashMove && IsQuietMove(move) && m_ChessBoard.IsPseudoLegalMove(move)) return move;
+			}
+
+			m_Stage = Stage::GenerateQuiets;
+			break;
+		}
+		case Stage::GenerateQuiets:
+		{
+			m_Moves.clear();
+			m_ChessBoard.GeneratePseudoLegalMoves(MoveGenerationType::Quiets, m_Moves);
+			ScoreQuiets();
+			m_MoveIndex = 0;
+
+			m_Stage = Stage::Quiets;
+			break;
+		}
+		case Stage::Quiets:
+		{
+			while (m_MoveIndex < m_Moves.size())
+			{
+				Move move{ PickBestMove() };
+				if (move != m_HashMove && !IsRefutationMove(move)) return move;
+			}
+
+			m_MoveIndex = 0;
+			m_Stage = Stage::BadCaptures;
+			break;
+		}
+		case Stage::BadCaptures:
+		{
+			if (m_MoveIndex < m_BadCaptures.size()) return m_BadCaptures[m_MoveIndex++];
+
+			m_Stage = Stage::Done;
+			break;
+		}
+		case Stage::Done:
+			return Move{};
+		}
+	}
+}
+
+bool MovePicker::IsQuietMove(Move move)
+{
+	switch (move.GetMoveType())
+	{
+	case MoveType::QuietMove: case MoveType::DoublePawnPush: case MoveType::KingCastle: case MoveType::QueenCastle:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void MovePicker::ScoreCaptures()
+{
+	for (int index{}; index < m_Moves.size(); ++index)
+	{
+		m_Scores[index] = MoveOrdering::GetCaptureScore(m_ChessBoard, m_Moves[index]);
+	}
+}
+void MovePicker::ScoreQuiets()
+{
+	const bool whiteToMove{ m_ChessBoard.GetWhiteToMove() };
+	for (int index{}; index < m_Moves.size(); ++index)
+	{
+		m_Scores[index] = m_pMoveOrdering ? m_pMoveOrdering->GetQuietScore(whiteToMove, m_Moves[index]) : 0;
+	}
+}
+Move MovePicker::PickBestMove()
+{
+	int bestIndex{ m_MoveIndex };
+	for (int index{ m_MoveIndex + 1 }; index < m_Moves.size(); ++index)
+	{
+		if (m_Scores[index] > m_Scores[bestIndex]) bestIndex = index;
+	}
+
+	std::swap(m_Moves[m_MoveIndex], m_Moves[bestIndex]);
+	std::swap(m_Scores[m_MoveIndex], m_Scores[bestIndex]);
+	return m_Moves[m_MoveIndex++];
+}
+bool MovePicker::IsRefutationMove(Move move) const
+{
+	return std::find(m_RefutationMoves.begin(), m_RefutationMoves.end(), move) != m_RefutationMoves.end();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ChessBoard.h"
+#include "MoveOrdering.h"
+#include <array>
+#include <iterator>
+
+// Hands out the pseudo-legal moves of a position one at a time, in stages: the hash move, the captures and promotions
+// that don't lose material, the killer and counter moves, the quiet moves and then the losing captures. A stage only gets generated once the ones before it ran out,
+// so a node that gets cut off by the hash move or a capture never generates its quiet moves.
+// Within a stage the moves get scored in place and handed out best first by a partial selection sort,
+// which only sorts as far as the search gets before it cuts off.
+// The board has to be back in the same position every time the next move is asked for.
+class MovePicker final
+{
+public:
+	// Without a MoveOrdering only the captures get ordered
+	MovePicker(ChessBoard& chessBoard, Move hashMove = {}, const MoveOrdering* pMoveOrdering = nullptr, int ply = 0);
+	// Only the moves of the generation type, without a hash move or refutations.
+	// With MoveGenerationType::Captures the losing captures get left out, the quiescence search has no use for them
+	MovePicker(ChessBoard& chessBoard, MoveGenerationType generationType);
+	~MovePicker() = default;
+
+	MovePicker(const MovePicker& other) = delete;
+	MovePicker(MovePicker&& other) = delete;
+	MovePicker& operator=(const MovePicker& other) = delete;
+	MovePicker& operator=(MovePicker&& other) noexcept = delete;
+
+
+	// Returns a NullMove once every stage is done
+	Move GetNextMove();
+
+	// The moves MoveGenerationType::Quiets generates
+	static bool IsQuietMove(Move move);
+
+	// So the moves can be walked with a range-based for loop
+	class Iterator
+	{
+	public:
+		explicit Iterator(MovePicker* pMovePicker) : m_pMovePicker{ pMovePicker }, m_Move{ pMovePicker->GetNextMove() } {}
+
+		Move operator*() const { return m_Move; }
+		Iterator& operator++() { m_Move = m_pMovePicker->GetNextMove(); return *this; }
+		bool operator!=(std::default_sentinel_t) const { return m_Move.GetMoveType() != MoveType::NullMove; }
+
+	private:
+		MovePicker* m_pMovePicker;
+		Move m_Move;
+	};
+	Iterator begin() { return Iterator{ this }; }
+	std::default_sentinel_t end() { return std::default_sentinel; }
+
+private:
+
+	enum class Stage
+	{
+		HashMove,
+		GenerateCaptures,
+		Captures,
+		Refutations,
+		GenerateQuiets,
+		Quiets,
+		BadCaptures,
+		Done
+	};
+
+	ChessBoard& m_ChessBoard;
+	const MoveOrdering* m_pMoveOrdering;
+	Move m_HashMove;
+	// The killer moves of this ply and the counter move of the last move, the quiet moves that refuted something before
+	std::array<Move, MoveOrdering::s_KillerMoveCount + 1> m_RefutationMoves{};
+
+	MoveGenerationType m_GenerationType{ MoveGenerationType::All };
+	Stage m_Stage{ Stage::HashMove };
+	MoveList m_Moves{};
+	std::array<int, MoveList::s_Capacity> m_Scores;
+	// The captures the static exchange evaluation says lose material, in the order they were picked
+	MoveList m_BadCaptures{};
+	int m_MoveIndex{};
+
+
+	void ScoreCaptures();
+	void ScoreQuiets();
+	Move PickBestMove();
+	bool IsRefutationMove(Move move) const;
+};
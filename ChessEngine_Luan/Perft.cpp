@@ -0,0 +1,197 @@
+#include "Perft.h"
+#include <algorithm>
+#include <bit>
+#include <thread>
+
+PerftResult& PerftResult::operator+=(const PerftResult& other)
+{
+	nodes += other.nodes;
+	captures += other.captures;
+	enPassants += other.enPassants;
+	castles += other.castles;
+	promotions += other.promotions;
+	checks += other.checks;
+	return *this;
+}
+
+Perft::Perft(int threadCount, int cacheSizeInMB)
+	: m_ThreadCount{ std::max(threadCount, 1) }
+{
+	uint64_t maxSlotCount{ (static_cast<uint64_t>(std::max(cacheSizeInMB, 0)) << 20) / sizeof(CacheSlot) };
+
+	// A power of two, so the slot index is just a mask of the key
+	m_CacheSlotCount = maxSlotCount ? std::bit_floor(maxSlotCount) : 0;
+	m_pCache = m_CacheSlotCount ? std::make_unique<CacheSlot[]>(m_CacheSlotCount) : nullptr;
+}
+
+PerftResult Perft::Run(const ChessBoard& chessBoard, int depth)
+{
+	if (depth <= 0) return PerftResult{ 1 };
+
+	PerftResult result{};
+	for (const PerftDivideEntry& entry : Divide(chessBoard, depth))
+	{
+		result += entry.result;
+	}
+	return result;
+}
+std::vector<PerftDivideEntry> Perft::Divide(const ChessBoard& chessBoard, int depth)
+{
+	ChessBoard rootBoard{ chessBoard };
+	rootBoard.SetDrawDetection(false);
+
+	// Only the legal root moves get an entry
+	MoveList rootMoves{};
+	for (Move move : GetMoves(rootBoard))
+	{
+		if (!MakeMove(rootBoard, move)) continue;
+
+		rootBoard.UnMakeLastMove();
+		rootMoves.push_back(move);
+	}
+
+	std::vector<PerftDivideEntry> entries(rootMoves.size());
+	if (depth <= 0) return entries;
+
+	// The threads take the next root move that nobody took yet, the subtrees differ too much in size to split them up front
+	std::atomic<int> nextIndex{};
+	auto CountRootMoves{ [&]()
+		{
+			ChessBoard threadBoard{ rootBoard };
+			for (int index{ nextIndex++ }; index < rootMoves.size(); index = nextIndex++)
+			{
+				Move move{ rootMoves[index] };
+				entries[index].move = move;
+
+				if (depth == 1)
+				{
+					CountLeaf(threadBoard, move, entries[index].result);
+					continue;
+				}
+
+				MakeMove(threadBoard, move);
+				entries[index].result = Count(threadBoard, depth - 1);
+				threadBoard.UnMakeLastMove();
+			}
+		} };
+
+	std::vector<std::thread> threads{};
+	threads.reserve(m_ThreadCount - 1);
+	for (int threadIndex{ 1 }; threadIndex < m_ThreadCount; ++threadIndex)
+	{
+		threads.emplace_back(CountRootMoves);
+	}
+	CountRootMoves();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	return entries;
+}
+
+PerftResult Perft::Count(ChessBoard& chessBoard, int depth)
+{
+	// UnMakeLastMove doesn't restore the possible moves, so walk over a copy
+	const MoveList possibleMoves{ GetMoves(chessBoard) };
+
+	PerftResult result{};
+	if (!m_CountDetails)
+	{
+		// Bulk counting: every generated legal move is a leaf, there is no need to make them
+		if (depth == 1 && !m_IsPseudoLegal) return PerftResult{ uint64_t(possibleMoves.size()) };
+
+		if (ProbeCache(chessBoard.GetZobristKey(), depth, result.nodes)) return result;
+	}
+
+	for (Move move : possibleMoves)
+	{
+		if (depth == 1)
+		{
+			CountLeaf(chessBoard, move, result);
+			continue;
+		}
+
+		if (!MakeMove(chessBoard, move)) continue;
+		result += Count(chessBoard, depth - 1);
+		chessBoard.UnMakeLastMove();
+	}
+
+	if (!m_CountDetails) StoreCache(chessBoard.GetZobristKey(), depth, result.nodes);
+	return result;
+}
+void Perft::CountLeaf(ChessBoard& chessBoard, Move move, PerftResult& result)
+{
+	if (!m_CountDetails && !m_IsPseudoLegal)
+	{
+		++result.nodes;
+		return;
+	}
+
+	if (!MakeMove(chessBoard, move)) return;
+	const bool givesCheck{ chessBoard.IsKingInCheck() };
+	chessBoard.UnMakeLastMove();
+
+	++result.nodes;
+	if (!m_CountDetails) return;
+	if (givesCheck) ++result.checks;
+
+	switch (move.GetMoveType())
+	{
+	case MoveType::Capture:
+		++result.captures;
+		break;
+	case MoveType::EnPassantCaptureLeft: case MoveType::EnPassantCaptureRight:
+		++result.captures;
+		++result.enPassants;
+		break;
+	case MoveType::KingCastle: case MoveType::QueenCastle:
+		++result.castles;
+		break;
+	case MoveType::KnightPromotionCapture: case MoveType::BishopPromotionCapture: case MoveType::RookPromotionCapture: case MoveType::QueenPromotionCapture:
+		++result.captures;
+		++result.promotions;
+		break;
+	case MoveType::KnightPromotion: case MoveType::BishopPromotion: case MoveType::RookPromotion: case MoveType::QueenPromotion:
+		++result.promotions;
+		break;
+	default:
+		break;
+	}
+}
+
+MoveList Perft::GetMoves(ChessBoard& chessBoard)
+{
+	if (m_IsPseudoLegal) return chessBoard.GetPseudoLegalMoves();
+	return chessBoard.GetPossibleMoves();
+}
+bool Perft::MakeMove(ChessBoard& chessBoard, Move move)
+{
+	if (m_IsPseudoLegal) return chessBoard.MakePseudoLegalMove(move);
+
+	chessBoard.MakeMove(move);
+	return true;
+}
+
+bool Perft::ProbeCache(uint64_t zobristKey, int depth, uint64_t& nodes)
+{
+	if (!m_CacheSlotCount) return false;
+
+	CacheSlot& slot{ m_pCache[zobristKey & (m_CacheSlotCount - 1)] };
+	uint64_t data{ slot.data.load(std::memory_order_relaxed) };
+	if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) != zobristKey || int(data & 0xFF) != depth) return false;
+
+	nodes = data >> 8;
+	return true;
+}
+void Perft::StoreCache(uint64_t zobristKey, int depth, uint64_t nodes)
+{
+	if (!m_CacheSlotCount) return;
+
+	// data layout: bits 0-7 depth, 8-63 node count
+	uint64_t data{ nodes << 8 | static_cast<uint64_t>(depth) };
+
+	CacheSlot& slot{ m_pCache[zobristKey & (m_CacheSlotCount - 1)] };
+	slot.keyXorData.store(zobristKey ^ data, std::memory_order_relaxed);
+	slot.data.store(data, std::memory_order_relaxed);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ChessBoard.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Counts of the positions at the last ply, the same numbers the chessprogramming wiki lists per depth
+struct PerftResult
+{
+	uint64_t nodes{};
+	uint64_t captures{};
+	uint64_t enPassants{};
+	uint64_t castles{};
+	uint64_t promotions{};
+	uint64_t checks{};
+
+	PerftResult& operator+=(const PerftResult& other);
+};
+
+struct PerftDivideEntry
+{
+	Move move{};
+	PerftResult result{};
+};
+
+// Walks the whole move generation tree to a depth, to compare the move generator against known node counts and to measure its speed.
+// The last ply is counted in bulk (the generated moves are counted, not made) and the root moves are split over the threads.
+// Every thread works on its own copy of the board, so nothing is shared but the optional cache.
+class Perft final
+{
+public:
+	Perft(int threadCount = 1, int cacheSizeInMB = 0);
+	~Perft() = default;
+
+	Perft(const Perft& other) = delete;
+	Perft(Perft&& other) = delete;
+	Perft& operator=(const Perft& other) = delete;
+	Perft& operator=(Perft&& other) noexcept = delete;
+
+
+	// The captures, en passants, castles, promotions and checks need every leaf move to be made, which turns bulk counting and the cache off
+	void SetCountDetails(bool countDetails) { m_CountDetails = countDetails; }
+	// Walks the tree the way the search does, with the pseudo-legal moves that MakePseudoLegalMove accepts.
+	// Every leaf then has to be made to know whether it counts, so there is no bulk counting
+	void SetPseudoLegal(bool isPseudoLegal) { m_IsPseudoLegal = isPseudoLegal; }
+
+	PerftResult Run(const ChessBoard& chessBoard, int depth);
+	// The same count split per root move, in the order the board generates them
+	std::vector<PerftDivideEntry> Divide(const ChessBoard& chessBoard, int depth);
+
+private:
+
+	int m_ThreadCount;
+	bool m_CountDetails{ false };
+	bool m_IsPseudoLegal{ false };
+
+	// Node counts of (position, depth) pairs. Lock-free like the TranspositionTable: a slot stores (key ^ data) next to data,
+	// so a slot torn by two threads fails the key check. The depth is part of data, so it gets checked along with the key
+	struct CacheSlot
+	{
+		std::atomic<uint64_t> keyXorData{};
+		std::atomic<uint64_t> data{};
+	};
+	std::unique_ptr<CacheSlot[]> m_pCache{};
+	uint64_t m_CacheSlotCount{};
+
+
+	PerftResult Count(ChessBoard& chessBoard, int depth);
+	void CountLeaf(ChessBoard& chessBoard, Move move, PerftResult& result);
+
+	// The legal or the pseudo-legal moves. A pseudo-legal move that leaves the own king in check doesn't get made and returns false
+	MoveList GetMoves(ChessBoard& chessBoard);
+	bool MakeMove(ChessBoard& chessBoard, Move move);
+
+	bool ProbeCache(uint64_t zobristKey, int depth, uint64_t& nodes);
+	void StoreCache(uint64_t zobristKey, int depth, uint64_t nodes);
+};
@@ -0,0 +1,29 @@
+#include "PieceSquareTables.h"
+#include "BitUtilities.h"
+
+PieceSquareScore PieceSquareTables::GetPiecesDifferenceScore(const BitBoards& before, const BitBoards& after)
+{
+	BitBoards beforeBitBoards{ before };
+	BitBoards afterBitBoards{ after };
+
+	PieceSquareScore score{};
+	for (int pieceIndex{}; pieceIndex < 12; ++pieceIndex)
+	{
+		const uint64_t beforePieces{ beforeBitBoards.GetPieceBitBoard(pieceIndex) };
+		const uint64_t afterPieces{ afterBitBoards.GetPieceBitBoard(pieceIndex) };
+
+		for (int squareIndex : BitUtilities::GetSetBits(beforePieces & ~afterPieces))
+		{
+			score.midgame -= GetMidgameValue(pieceIndex, squareIndex);
+			score.endgame -= GetEndgameValue(pieceIndex, squareIndex);
+			--score.pieceCount;
+		}
+		for (int squareIndex : BitUtilities::GetSetBits(afterPieces & ~beforePieces))
+		{
+			score.midgame += GetMidgameValue(pieceIndex, squareIndex);
+			score.endgame += GetEndgameValue(pieceIndex, squareIndex);
+			++score.pieceCount;
+		}
+	}
+	return score;
+}
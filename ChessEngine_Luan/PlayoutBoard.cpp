@@ -0,0 +1,260 @@
+#include "PlayoutBoard.h"
+#include "BitUtilities.h"
+#include "MagicBitBoards.h"
+#include "RandomUtilities.h"
+
+namespace
+{
+	constexpr uint64_t g_NotFirstColumn{ ~0x0101010101010101ull };
+	constexpr uint64_t g_NotLastColumn{ ~0x8080808080808080ull };
+	// Square 0 is a8, so white promotes on the lowest row and black on the highest
+	constexpr uint64_t g_WhitePromotionRow{ 0x00000000000000FFull };
+	constexpr uint64_t g_BlackPromotionRow{ 0xFF00000000000000ull };
+	// Where a single push from the starting row ends up, the pawns there can push once more
+	constexpr uint64_t g_WhiteDoublePushRow{ 0x0000FF0000000000ull };
+	constexpr uint64_t g_BlackDoublePushRow{ 0x0000000000FF0000ull };
+}
+
+PlayoutBoard::PlayoutBoard(const GameState& gameState)
+	: m_BitBoards{ gameState.bitBoards }
+	, m_WhiteToMove{ gameState.whiteToMove }
+	, m_EnPassantSquares{ gameState.enPassantSquares }
+	, m_GameProgress{ gameState.gameProgress }
+{
+}
+
+int PlayoutBoard::Playout(int maxPlies, PlayoutPolicy policy, uint64_t& randomState)
+{
+	// One list for the whole playout, making one zeroes all of its moves
+	MoveList moves{};
+
+	int plyCount{};
+	for (; plyCount < maxPlies && m_GameProgress == GameProgress::InProgress; ++plyCount)
+	{
+		moves.clear();
+
+		bool hasPlayedMove{ false };
+		if (policy == PlayoutPolicy::CapturesFirst)
+		{
+			GenerateMoves(MoveGenerationType::Captures, moves);
+			hasPlayedMove = PlayRandomLegalMove(moves, randomState);
+
+			// Every capture that didn't get played was illegal and is out of the list by now
+			if (!hasPlayedMove) GenerateMoves(MoveGenerationType::Quiets, moves);
+		}
+		else GenerateMoves(MoveGenerationType::All, moves);
+
+		if (!hasPlayedMove && !PlayRandomLegalMove(moves, randomState))
+		{
+			if (!IsKingInCheck()) m_GameProgress = GameProgress::Draw;
+			else m_GameProgress = m_WhiteToMove ? GameProgress::BlackWon : GameProgress::WhiteWon;
+			break;
+		}
+
+		if ((m_BitBoards.whitePieces | m_BitBoards.blackPieces) == (m_BitBoards.whiteKing | m_BitBoards.blackKing))
+		{
+			m_GameProgress = GameProgress::Draw;
+		}
+	}
+	return plyCount;
+}
+
+bool PlayoutBoard::IsKingInCheck() const
+{
+	const uint64_t kingBitBoard{ m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing };
+	return kingBitBoard && IsSquareAttacked(BitUtilities::GetLsb(kingBitBoard), !m_WhiteToMove);
+}
+GameState PlayoutBoard::GetGameState() const
+{
+	GameState gameState{};
+	gameState.gameProgress = m_GameProgress;
+	gameState.bitBoards = m_BitBoards;
+	gameState.whiteToMove = m_WhiteToMove;
+	gameState.enPassantSquares = m_EnPassantSquares;
+	return gameState;
+}
+
+void PlayoutBoard::GenerateMoves(MoveGenerationType generationType, MoveList& moves) const
+{
+	const uint64_t ownPiecesBitBoard{ m_WhiteToMove ? m_BitBoards.whitePieces : m_BitBoards.blackPieces };
+	const uint64_t opponentPiecesBitBoard{ m_WhiteToMove ? m_BitBoards.blackPieces : m_BitBoards.whitePieces };
+	const uint64_t occupancy{ ownPiecesBitBoard | opponentPiecesBitBoard };
+	const uint64_t emptyBitBoard{ ~occupancy };
+
+	// Promotions count as captures, just like for ChessBoard
+	const bool includeCaptures{ generationType != MoveGenerationType::Quiets };
+	const bool includeQuiets{ generationType != MoveGenerationType::Captures };
+	const uint64_t promotionRow{ m_WhiteToMove ? g_WhitePromotionRow : g_BlackPromotionRow };
+
+	// Pawns a whole row at a time, every target square knows its start square from the offset
+	const uint64_t pawnsBitBoard{ m_WhiteToMove ? m_BitBoards.whitePawns : m_BitBoards.blackPawns };
+	const int forwardOffset{ m_WhiteToMove ? -8 : 8 };
+
+	const uint64_t pushSquares{ (m_WhiteToMove ? pawnsBitBoard >> 8 : pawnsBitBoard << 8) & emptyBitBoard };
+	if (includeCaptures) AddPawnMoves(pushSquares & promotionRow, -forwardOffset, false, moves);
+	if (includeQuiets)
+	{
+		AddPawnMoves(pushSquares & ~promotionRow, -forwardOffset, false, moves);
+
+		uint64_t doublePushSquares{ pushSquares & (m_WhiteToMove ? g_WhiteDoublePushRow : g_BlackDoublePushRow) };
+		doublePushSquares = (m_WhiteToMove ? doublePushSquares >> 8 : doublePushSquares << 8) & emptyBitBoard;
+		for (int targetSquareIndex : BitUtilities::GetSetBits(doublePushSquares))
+		{
+			moves.emplace_back(Move{ targetSquareIndex - 2 * forwardOffset, targetSquareIndex, MoveType::DoublePawnPush });
+		}
+	}
+	if (includeCaptures)
+	{
+		// Left is towards the first column, for both colors
+		const uint64_t leftCaptureSquares{ m_WhiteToMove ? (pawnsBitBoard & g_NotFirstColumn) >> 9 : (pawnsBitBoard & g_NotFirstColumn) << 7 };
+		const uint64_t rightCaptureSquares{ m_WhiteToMove ? (pawnsBitBoard & g_NotLastColumn) >> 7 : (pawnsBitBoard & g_NotLastColumn) << 9 };
+		const int leftStartOffset{ m_WhiteToMove ? 9 : -7 };
+		const int rightStartOffset{ m_WhiteToMove ? 7 : -9 };
+
+		AddPawnMoves(leftCaptureSquares & opponentPiecesBitBoard, leftStartOffset, true, moves);
+		AddPawnMoves(rightCaptureSquares & opponentPiecesBitBoard, rightStartOffset, true, moves);
+
+		for (int targetSquareIndex : BitUtilities::GetSetBits(leftCaptureSquares & m_EnPassantSquares))
+		{
+			moves.emplace_back(Move{ targetSquareIndex + leftStartOffset, targetSquareIndex, MoveType::EnPassantCaptureLeft });
+		}
+		for (int targetSquareIndex : BitUtilities::GetSetBits(rightCaptureSquares & m_EnPassantSquares))
+		{
+			moves.emplace_back(Move{ targetSquareIndex + rightStartOffset, targetSquareIndex, MoveType::EnPassantCaptureRight });
+		}
+	}
+
+	uint64_t targetMask{};
+	if (includeCaptures) targetMask |= opponentPiecesBitBoard;
+	if (includeQuiets) targetMask |= emptyBitBoard;
+
+	// Knights, bishops, rooks, queens and the king
+	const uint64_t pieceBitBoards[5]
+	{
+		m_WhiteToMove ? m_BitBoards.whiteKnights : m_BitBoards.blackKnights,
+		m_WhiteToMove ? m_BitBoards.whiteBishops : m_BitBoards.blackBishops,
+		m_WhiteToMove ? m_BitBoards.whiteRooks : m_BitBoards.blackRooks,
+		m_WhiteToMove ? m_BitBoards.whiteQueens : m_BitBoards.blackQueens,
+		m_WhiteToMove ? m_BitBoards.whiteKing : m_BitBoards.blackKing
+	};
+	for (int pieceOffset{}; pieceOffset < 5; ++pieceOffset)
+	{
+		for (int squareIndex : BitUtilities::GetSetBits(pieceBitBoards[pieceOffset]))
+		{
+			uint64_t attackBitBoard{};
+			switch (pieceOffset)
+			{
+			case 0: attackBitBoard = MagicBitBoards::GetKnightAttacks(squareIndex); break;
+			case 1: attackBitBoard = MagicBitBoards::GetBishopAttacks(squareIndex, occupancy); break;
+			case 2: attackBitBoard = MagicBitBoards::GetRookAttacks(squareIndex, occupancy); break;
+			case 3: attackBitBoard = MagicBitBoards::GetQueenAttacks(squareIndex, occupancy); break;
+			default: attackBitBoard = MagicBitBoards::GetKingAttacks(squareIndex); break;
+			}
+
+			for (int targetSquareIndex : BitUtilities::GetSetBits(attackBitBoard & targetMask))
+			{
+				moves.emplace_back(Move{ squareIndex, targetSquareIndex, (opponentPiecesBitBoard >> targetSquareIndex) & 1 ? MoveType::Capture : MoveType::QuietMove });
+			}
+		}
+	}
+}
+void PlayoutBoard::AddPawnMoves(uint64_t targetSquares, int startSquareOffset, bool isCapture, MoveList& moves) const
+{
+	const uint64_t promotionRow{ m_WhiteToMove ? g_WhitePromotionRow : g_BlackPromotionRow };
+
+	for (int targetSquareIndex : BitUtilities::GetSetBits(targetSquares))
+	{
+		const int startSquareIndex{ targetSquareIndex + startSquareOffset };
+		if (!((promotionRow >> targetSquareIndex) & 1))
+		{
+			moves.emplace_back(Move{ startSquareIndex, targetSquareIndex, isCapture ? MoveType::Capture : MoveType::QuietMove });
+			continue;
+		}
+		moves.emplace_back(Move{ startSquareIndex, targetSquareIndex, isCapture ? MoveType::QueenPromotionCapture : MoveType::QueenPromotion });
+		moves.emplace_back(Move{ startSquareIndex, targetSquareIndex, isCapture ? MoveType::RookPromotionCapture : MoveType::RookPromotion });
+		moves.emplace_back(Move{ startSquareIndex, targetSquareIndex, isCapture ? MoveType::BishopPromotionCapture : MoveType::BishopPromotion });
+		moves.emplace_back(Move{ startSquareIndex, targetSquareIndex, isCapture ? MoveType::KnightPromotionCapture : MoveType::KnightPromotion });
+	}
+}
+bool PlayoutBoard::PlayRandomLegalMove(MoveList& moves, uint64_t& randomState)
+{
+	while (!moves.empty())
+	{
+		const int moveIndex{ RandomUtilities::GetRandomIndex(moves.size(), randomState) };
+		if (MakeMove(moves[moveIndex])) return true;
+
+		moves[moveIndex] = moves.back();
+		moves.pop_back();
+	}
+	return false;
+}
+
+bool PlayoutBoard::MakeMove(Move move)
+{
+	const int startSquareIndex{ move.GetStartSquareIndex() };
+	const int targetSquareIndex{ move.GetTargetSquareIndex() };
+	const MoveType moveType{ move.GetMoveType() };
+
+	const uint64_t startBitBoard{ uint64_t(1) << startSquareIndex };
+	const uint64_t targetBitBoard{ uint64_t(1) << targetSquareIndex };
+	const int firstPieceIndex{ m_WhiteToMove ? 0 : 6 };
+	const int firstOpponentPieceIndex{ m_WhiteToMove ? 6 : 0 };
+
+	// Only the pieces change before the move turns out to be legal
+	const BitBoards previousBitBoards{ m_BitBoards };
+
+	uint64_t capturedBitBoard{ targetBitBoard };
+	if (moveType == MoveType::EnPassantCaptureLeft || moveType == MoveType::EnPassantCaptureRight)
+	{
+		capturedBitBoard = m_WhiteToMove ? targetBitBoard << 8 : targetBitBoard >> 8;
+	}
+	uint64_t& opponentPiecesBitBoard{ m_WhiteToMove ? m_BitBoards.blackPieces : m_BitBoards.whitePieces };
+	if (opponentPiecesBitBoard & capturedBitBoard)
+	{
+		for (int pieceIndex{ firstOpponentPieceIndex }; pieceIndex < firstOpponentPieceIndex + 6; ++pieceIndex)
+		{
+			m_BitBoards.GetPieceBitBoard(pieceIndex) &= ~capturedBitBoard;
+		}
+		opponentPiecesBitBoard &= ~capturedBitBoard;
+	}
+
+	int pieceIndex{ firstPieceIndex };
+	while (!(m_BitBoards.GetPieceBitBoard(pieceIndex) & startBitBoard)) ++pieceIndex;
+	m_BitBoards.GetPieceBitBoard(pieceIndex) ^= startBitBoard;
+
+	// KnightPromotion ... QueenPromotion and their captures follow the piece order knight, bishop, rook, queen
+	const int moveTypeIndex{ static_cast<int>(moveType) };
+	if (moveTypeIndex >= static_cast<int>(MoveType::KnightPromotion))
+	{
+		pieceIndex = firstPieceIndex + 1 + (moveTypeIndex - static_cast<int>(MoveType::KnightPromotion)) % 4;
+	}
+	m_BitBoards.GetPieceBitBoard(pieceIndex) |= targetBitBoard;
+	(m_WhiteToMove ? m_BitBoards.whitePieces : m_BitBoards.blackPieces) ^= startBitBoard | targetBitBoard;
+
+	if (IsKingInCheck())
+	{
+		m_BitBoards = previousBitBoards;
+		return false;
+	}
+
+	m_EnPassantSquares = moveType == MoveType::DoublePawnPush ? uint64_t(1) << ((startSquareIndex + targetSquareIndex) / 2) : 0;
+	m_WhiteToMove = !m_WhiteToMove;
+	return true;
+}
+bool PlayoutBoard::IsSquareAttacked(int squareIndex, bool byWhite) const
+{
+	const uint64_t squareBitBoard{ uint64_t(1) << squareIndex };
+	const uint64_t occupancy{ m_BitBoards.whitePieces | m_BitBoards.blackPieces };
+
+	// The squares a pawn of that color would have to stand on to attack this one
+	const uint64_t pawnSquares{ byWhite ? ((squareBitBoard & g_NotFirstColumn) << 7) | ((squareBitBoard & g_NotLastColumn) << 9)
+										: ((squareBitBoard & g_NotFirstColumn) >> 9) | ((squareBitBoard & g_NotLastColumn) >> 7) };
+	if (pawnSquares & (byWhite ? m_BitBoards.whitePawns : m_BitBoards.blackPawns)) return true;
+
+	if (MagicBitBoards::GetKnightAttacks(squareIndex) & (byWhite ? m_BitBoards.whiteKnights : m_BitBoards.blackKnights)) return true;
+	if (MagicBitBoards::GetKingAttacks(squareIndex) & (byWhite ? m_BitBoards.whiteKing : m_BitBoards.blackKing)) return true;
+
+	const uint64_t queensBitBoard{ byWhite ? m_BitBoards.whiteQueens : m_BitBoards.blackQueens };
+	if (MagicBitBoards::GetBishopAttacks(squareIndex, occupancy) & ((byWhite ? m_BitBoards.whiteBishops : m_BitBoards.blackBishops) | queensBitBoard)) return true;
+	return MagicBitBoards::GetRookAttacks(squareIndex, occupancy) & ((byWhite ? m_BitBoards.whiteRooks : m_BitBoards.blackRooks) | queensBitBoard);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ChessStructs.h"
+
+// How a playout picks its moves
+enum class PlayoutPolicy
+{
+	Random,
+	// A random capture or promotion whenever one is legal, a random other move otherwise
+	CapturesFirst
+};
+
+// A stripped-down board for MCTS playouts: only the pieces, the side to move and the en passant squares.
+// No history, repetitions, threat maps, pins or Zobrist keys, so moves can't be taken back and castling is left out.
+// It starts from a copy of a ChessBoard's GameState, a playout never touches the board it came from
+class PlayoutBoard final
+{
+public:
+	explicit PlayoutBoard(const GameState& gameState);
+	~PlayoutBoard() = default;
+
+	PlayoutBoard(const PlayoutBoard& other) = default;
+	PlayoutBoard(PlayoutBoard&& other) noexcept = default;
+	PlayoutBoard& operator=(const PlayoutBoard& other) = default;
+	PlayoutBoard& operator=(PlayoutBoard&& other) noexcept = default;
+
+	// Plays up to maxPlies moves picked by the policy, fewer when the game ends on the way. Returns the moves played.
+	// randomState is the state of an xorshift generator, anything but 0, every search thread keeps its own
+	int Playout(int maxPlies, PlayoutPolicy policy, uint64_t& randomState);
+
+	// Checkmate, stalemate and bare kings, the only endings a playout looks for
+	GameProgress GetGameProgress() const { return m_GameProgress; }
+	bool GetWhiteToMove() const { return m_WhiteToMove; }
+	bool IsKingInCheck() const;
+	// In the shape ChessAI::BoardValueEvaluation takes, without possible moves, castling rights or a Zobrist key
+	GameState GetGameState() const;
+
+private:
+
+	BitBoards m_BitBoards;
+	bool m_WhiteToMove;
+	uint64_t m_EnPassantSquares;
+	GameProgress m_GameProgress;
+
+	// Pseudo-legal moves, like ChessBoard::GeneratePseudoLegalMoves without castling. Appends to moves
+	void GenerateMoves(MoveGenerationType generationType, MoveList& moves) const;
+	void AddPawnMoves(uint64_t targetSquares, int startSquareOffset, bool isCapture, MoveList& moves) const;
+	// Tries the moves in a random order until one is legal, the illegal ones get taken out of the list
+	bool PlayRandomLegalMove(MoveList& moves, uint64_t& randomState);
+	// False, with the position left as it was, when the move leaves the own king in check
+	bool MakeMove(Move move);
+	bool IsSquareAttacked(int squareIndex, bool byWhite) const;
+};
@@ -0,0 +1,28 @@
+#include "PrincipalVariationTable.h"
+#include <algorithm>
+
+void PrincipalVariationTable::Clear(int ply)
+{
+	if (ply < s_MaxPly) m_Lengths[ply] = 0;
+}
+void PrincipalVariationTable::Update(int ply, Move move)
+{
+	if (ply >= s_MaxPly) return;
+
+	// The child node cleared its line when it started, so a child that didn't raise alpha adds nothing
+	const int childLength{ ply + 1 < s_MaxPly ? std::min(m_Lengths[ply + 1], s_MaxPly - ply - 1) : 0 };
+
+	m_Lines[ply][0] = move;
+	if (childLength > 0) std::copy_n(m_Lines[ply + 1].begin(), childLength, m_Lines[ply].begin() + 1);
+	m_Lengths[ply] = childLength + 1;
+}
+
+MoveList PrincipalVariationTable::GetPrincipalVariation() const
+{
+	MoveList principalVariation{};
+	for (int index{}; index < m_Lengths[0]; ++index)
+	{
+		principalVariation.push_back(m_Lines[0][index]);
+	}
+	return principalVariation;
+}
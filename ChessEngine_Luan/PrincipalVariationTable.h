@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ChessStructs.h"
+#include <array>
+
+// Triangular principal variation table: every ply keeps the best line found below it so far, and a move that raises
+// alpha copies the line of the ply after it behind itself. Ply 0 ends up holding the whole principal variation.
+// Every search thread owns one, the line it holds comes from the search itself so nothing can overwrite it like in the transposition table
+class PrincipalVariationTable final
+{
+public:
+	static constexpr int s_MaxPly{ 128 };
+
+	PrincipalVariationTable() = default;
+	~PrincipalVariationTable() = default;
+
+	PrincipalVariationTable(const PrincipalVariationTable& other) = delete;
+	PrincipalVariationTable(PrincipalVariationTable&& other) = delete;
+	PrincipalVariationTable& operator=(const PrincipalVariationTable& other) = delete;
+	PrincipalVariationTable& operator=(PrincipalVariationTable&& other) noexcept = delete;
+
+
+	// At the start of every node, a node that doesn't raise alpha leaves no line behind
+	void Clear(int ply);
+	// For the move that raised alpha at this ply
+	void Update(int ply, Move move);
+
+	MoveList GetPrincipalVariation() const;
+
+private:
+
+	std::array<std::array<Move, s_MaxPly>, s_MaxPly> m_Lines{};
+	std::array<int, s_MaxPly + 1> m_Lengths{};
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "stdint.h"
+
+// A random generator without shared state, for search threads that each keep their own. The state is any 64-bit value but 0.
+// Unlike rand() it takes no lock, and the same seed always gives the same numbers
+class RandomUtilities final
+{
+public:
+	RandomUtilities() = delete;
+
+	// xorshift64*, scaled to [0, count) without a division
+	static constexpr int GetRandomIndex(int count, uint64_t& randomState)
+	{
+		randomState ^= randomState >> 12;
+		randomState ^= randomState << 25;
+		randomState ^= randomState >> 27;
+		const uint64_t random{ randomState * 2685821657736338717ull };
+		return int(((random >> 32) * uint64_t(count)) >> 32);
+	}
+};
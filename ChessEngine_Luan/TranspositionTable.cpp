@@ -0,0 +1,118 @@
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+void TranspositionTable::Resize(int sizeInMB)
+{
+	uint64_t maxBucketCount{ (static_cast<uint64_t>(std::max(sizeInMB, 0)) << 20) / sizeof(Bucket) };
+
+	// Round down to a power of two so the bucket index is just a mask of the key
+	m_BucketCount = maxBucketCount ? std::bit_floor(maxBucketCount) : 0;
+	m_pBuckets = m_BucketCount ? std::make_unique<Bucket[]>(m_BucketCount) : nullptr;
+
+	Clear();
+}
+void TranspositionTable::Clear()
+{
+	for (uint64_t index{}; index < m_BucketCount; ++index)
+	{
+		for (Slot& slot : m_pBuckets[index].slots)
+		{
+			slot.keyXorData.store(0, std::memory_order_relaxed);
+			slot.data.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	m_Generation = 0;
+}
+void TranspositionTable::NewSearch()
+{
+	m_Generation = (m_Generation + 1) & 63;
+}
+
+bool TranspositionTable::Probe(uint64_t zobristKey, TranspositionEntry& entry)
+{
+	if (!m_BucketCount) return false;
+
+	for (Slot& slot : GetBucket(zobristKey).slots)
+	{
+		uint64_t data{ slot.data.load(std::memory_order_relaxed) };
+		if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) != zobristKey) continue;
+
+		entry = UnpackData(data);
+		return entry.boundType != BoundType::None;
+	}
+	return false;
+}
+void TranspositionTable::Store(uint64_t zobristKey, int depth, BoundType boundType, float score, Move bestMove)
+{
+	if (!m_BucketCount) return;
+
+	Slot* pReplaceSlot{};
+	int lowestReplaceValue{ INT_MAX };
+
+	for (Slot& slot : GetBucket(zobristKey).slots)
+	{
+		uint64_t data{ slot.data.load(std::memory_order_relaxed) };
+		TranspositionEntry entry{ UnpackData(data) };
+
+		if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) == zobristKey)
+		{
+			// Same position: always take the newer result, but don't forget a best move we already knew
+			if (bestMove.GetMoveType() == MoveType::NullMove) bestMove = entry.bestMove;
+			pReplaceSlot = &slot;
+			break;
+		}
+
+		// Empty slots go first, then shallow results from old searches
+		int replaceValue{ entry.boundType == BoundType::None ? INT_MIN : entry.depth - 8 * ((m_Generation - GetDataGeneration(data)) & 63) };
+		if (replaceValue < lowestReplaceValue)
+		{
+			lowestReplaceValue = replaceValue;
+			pReplaceSlot = &slot;
+		}
+	}
+
+	uint64_t data{ PackData(score, bestMove, depth, boundType, m_Generation) };
+	pReplaceSlot->keyXorData.store(zobristKey ^ data, std::memory_order_relaxed);
+	pReplaceSlot->data.store(data, std::memory_order_relaxed);
+}
+
+float TranspositionTable::GetFillRate() const
+{
+	// Sampling the first buckets is enough, the keys spread evenly over the table
+	uint64_t sampleBucketCount{ std::min(m_BucketCount, static_cast<uint64_t>(1024)) };
+	if (!sampleBucketCount) return 0.f;
+
+	int usedSlotCount{};
+	for (uint64_t index{}; index < sampleBucketCount; ++index)
+	{
+		for (const Slot& slot : m_pBuckets[index].slots)
+		{
+			if (UnpackData(slot.data.load(std::memory_order_relaxed)).boundType != BoundType::None) ++usedSlotCount;
+		}
+	}
+	return float(usedSlotCount) / (sampleBucketCount * s_EntriesPerBucket);
+}
+
+uint64_t TranspositionTable::PackData(float score, Move bestMove, int depth, BoundType boundType, uint8_t generation)
+{
+	return	static_cast<uint64_t>(std::bit_cast<uint32_t>(score)) |
+			static_cast<uint64_t>(bestMove.GetData()) << 32 |
+			static_cast<uint64_t>(std::clamp(depth, 0, 255)) << 48 |
+			static_cast<uint64_t>(boundType) << 56 |
+			static_cast<uint64_t>(generation & 63) << 58;
+}
+TranspositionEntry TranspositionTable::UnpackData(uint64_t data)
+{
+	TranspositionEntry entry{};
+	entry.score = std::bit_cast<float>(static_cast<uint32_t>(data));
+
+	uint16_t moveData{ static_cast<uint16_t>(data >> 32) };
+	entry.bestMove = Move{ moveData & 0x3F, (moveData >> 6) & 0x3F, static_cast<MoveType>(moveData >> 12) };
+
+	entry.depth = int((data >> 48) & 0xFF);
+	entry.boundType = static_cast<BoundType>((data >> 56) & 3);
+	return entry;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ChessStructs.h"
+#include <atomic>
+#include <memory>
+
+enum class BoundType
+{
+	None,
+
+	Exact,
+	LowerBound,
+	UpperBound
+};
+
+struct TranspositionEntry
+{
+	float score{};
+	Move bestMove{};
+	int depth{};
+	BoundType boundType{ BoundType::None };
+};
+
+// Fixed-size hash table of search results, indexed by the board's Zobrist key.
+// Safe to share between threads without locks: every slot is two 64-bit words and the first one stores (key ^ data),
+// so a slot torn by two threads writing at the same time simply fails the key check on the next probe.
+class TranspositionTable final
+{
+public:
+	TranspositionTable(int sizeInMB = 0) { Resize(sizeInMB); }
+	~TranspositionTable() = default;
+
+	TranspositionTable(const TranspositionTable& other) = delete;
+	TranspositionTable(TranspositionTable&& other) = delete;
+	TranspositionTable& operator=(const TranspositionTable& other) = delete;
+	TranspositionTable& operator=(TranspositionTable&& other) noexcept = delete;
+
+
+	void Resize(int sizeInMB);
+	void Clear();
+	// Ages the entries of previous searches so they get replaced first
+	void NewSearch();
+
+	bool Probe(uint64_t zobristKey, TranspositionEntry& entry);
+	void Store(uint64_t zobristKey, int depth, BoundType boundType, float score, Move bestMove);
+
+	int GetSizeInMB() const { return int((m_BucketCount * sizeof(Bucket)) >> 20); }
+	float GetFillRate() const;
+
+private:
+
+	static constexpr int s_EntriesPerBucket{ 4 };
+
+	struct Slot
+	{
+		std::atomic<uint64_t> keyXorData{};
+		std::atomic<uint64_t> data{};
+	};
+	// One bucket fills exactly one cache line, so a probe never touches more than one line
+	struct alignas(64) Bucket
+	{
+		Slot slots[s_EntriesPerBucket];
+	};
+	static_assert(sizeof(Bucket) == 64);
+
+	std::unique_ptr<Bucket[]> m_pBuckets{};
+	uint64_t m_BucketCount{};
+	uint8_t m_Generation{};
+
+	Bucket& GetBucket(uint64_t zobristKey) { return m_pBuckets[zobristKey & (m_BucketCount - 1)]; }
+
+	// data layout: bits 0-31 score, 32-47 move, 48-55 depth, 56-57 bound type, 58-63 generation
+	static uint64_t PackData(float score, Move bestMove, int depth, BoundType boundType, uint8_t generation);
+	static TranspositionEntry UnpackData(uint64_t data);
+	static int GetDataGeneration(uint64_t data) { return int(data >> 58); }
+};
@@ -0,0 +1,69 @@
+#include "Zobrist.h"
+#include "BitUtilities.h"
+#include "ChessStructs.h"
+#include <random>
+
+uint64_t Zobrist::s_PieceKeys[12][64]{};
+uint64_t Zobrist::s_SideToMoveKey{};
+uint64_t Zobrist::s_CastlingKeys[16]{};
+uint64_t Zobrist::s_EnPassantKeys[8]{};
+
+const bool Zobrist::s_IsInitialized{ Zobrist::Initialize() };
+
+bool Zobrist::Initialize()
+{
+	std::mt19937_64 random{ 20231213 };
+
+	for (auto& pieceKeys : s_PieceKeys)
+	{
+		for (auto& key : pieceKeys) key = random();
+	}
+
+	s_SideToMoveKey = random();
+
+	// Index 0 (no castling rights left) keeps a key of 0
+	for (int index{ 1 }; index < 16; ++index)
+	{
+		s_CastlingKeys[index] = random();
+	}
+
+	for (auto& key : s_EnPassantKeys) key = random();
+
+	return true;
+}
+
+uint64_t Zobrist::GetEnPassantKey(uint64_t enPassantSquares)
+{
+	if (!enPassantSquares) return 0;
+	return s_EnPassantKeys[BitUtilities::GetLsb(enPassantSquares) % 8];
+}
+
+uint64_t Zobrist::GetPiecesDifferenceKey(const BitBoards& before, const BitBoards& after)
+{
+	const uint64_t changedBitBoards[12]
+	{
+		before.whitePawns ^ after.whitePawns,
+		before.whiteKnights ^ after.whiteKnights,
+		before.whiteBishops ^ after.whiteBishops,
+		before.whiteRooks ^ after.whiteRooks,
+		before.whiteQueens ^ after.whiteQueens,
+		before.whiteKing ^ after.whiteKing,
+
+		before.blackPawns ^ after.blackPawns,
+		before.blackKnights ^ after.blackKnights,
+		before.blackBishops ^ after.blackBishops,
+		before.blackRooks ^ after.blackRooks,
+		before.blackQueens ^ after.blackQueens,
+		before.blackKing ^ after.blackKing
+	};
+
+	uint64_t key{};
+	for (int pieceIndex{}; pieceIndex < 12; ++pieceIndex)
+	{
+		for (int squareIndex : BitUtilities::GetSetBits(changedBitBoards[pieceIndex]))
+		{
+			key ^= s_PieceKeys[pieceIndex][squareIndex];
+		}
+	}
+	return key;
+}
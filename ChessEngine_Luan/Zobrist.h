@@ -0,0 +1,31 @@
+#pragma once
+
+#include "stdint.h"
+
+struct BitBoards;
+
+// Random keys for Zobrist hashing, generated once at program startup from a fixed seed.
+// Piece indices follow the BitBoards layout: whitePawns ... whiteKing = 0-5, blackPawns ... blackKing = 6-11.
+class Zobrist final
+{
+public:
+	Zobrist() = delete;
+
+	static uint64_t GetPieceKey(int pieceIndex, int squareIndex) { return s_PieceKeys[pieceIndex][squareIndex]; }
+	static uint64_t GetSideToMoveKey() { return s_SideToMoveKey; }
+	static uint64_t GetCastlingKey(int castlingRightsMask) { return s_CastlingKeys[castlingRightsMask]; }
+	static uint64_t GetEnPassantKey(uint64_t enPassantSquares);
+
+	// XOR of the piece keys of every square that differs between the two positions
+	static uint64_t GetPiecesDifferenceKey(const BitBoards& before, const BitBoards& after);
+
+private:
+	static uint64_t s_PieceKeys[12][64];
+	static uint64_t s_SideToMoveKey;
+	static uint64_t s_CastlingKeys[16];
+	static uint64_t s_EnPassantKeys[8];
+
+	static const bool s_IsInitialized;
+
+	static bool Initialize();
+};